@@ -19,6 +19,11 @@ typedef enum {
     LOG_LEVEL_ERROR = 3
 } LogLevel;
 
+/* 级别位图，用于 LogSetOutputFilter */
+#define LOG_LEVEL_MASK(level)       (1u << (level))
+#define LOG_LEVEL_MASK_FROM(level)  (0xFu & ~(LOG_LEVEL_MASK(level) - 1u))   // level 及以上
+#define LOG_LEVEL_MASK_ALL          0xFu
+
 /* ======================= 滚动模式 ======================= */
 typedef enum {
     LOG_ROLL_NONE = 0,   // 不滚动
@@ -34,10 +39,45 @@ typedef enum {
     LOG_OUTPUT_UDP           // 预留网络输出
 } LogOutputType;
 
+/* ======================= fork 行为 ======================= */
+typedef enum {
+    LOG_FORK_INHERIT = 0,    // 子进程重建写线程，继续追加到同一文件（默认，滚动只由父进程执行）
+    LOG_FORK_PER_PID,        // 子进程改写到文件名追加 .<pid> 的新文件
+    LOG_FORK_DISABLE         // 子进程中关闭日志（之后添加输出也不会重新开启）
+} LogForkMode;
+
+/* ======================= 重复消息合并 ======================= */
+typedef enum {
+    LOG_DEDUP_OFF = 0,       // 不合并（默认）
+    LOG_DEDUP_EXACT,         // 合并内容完全相同的连续记录
+    LOG_DEDUP_FORMAT         // 合并格式串与级别相同的连续记录（参数可不同）
+} LogDedupMode;
+
+/* ======================= 时间索引文件格式 ======================= */
+/* <日志文件>.idx：LOG_INDEX_HEADER_LEN 字节文件头（以 LOG_INDEX_MAGIC 开头），
+ * 之后是按时间递增的 LogIndexEntry（本机字节序） */
+#define LOG_INDEX_MAGIC       "LGIOIDX1"
+#define LOG_INDEX_HEADER_LEN  16
+
+typedef struct {
+    int64_t timestamp;   // 该偏移处记录的时间戳（秒）
+    int64_t offset;      // 记录在日志文件中的起始字节偏移
+} LogIndexEntry;
+
+/* ======================= 尾随读取游标 ======================= */
+typedef struct {
+    uint64_t next;       // 下一条要读取的记录序号
+    uint64_t lost;       // 因读取过慢被覆盖而跳过的记录数
+} LogTailCursor;
+
 /* ======================= 回调钩子 ======================= */
 typedef void (*LogCallback)(LogLevel level, const char *message, time_t timestamp,
                             int is_json, void *userdata);
 
+/* ======================= 延迟渲染 ======================= */
+/* 在写线程中把 payload 渲染为正文写入 buf（最多 cap - 1 字节），返回写入长度 */
+typedef size_t (*LogRenderFn)(const void *payload, size_t len, char *buf, size_t cap);
+
 /* ======================= 公共接口（LOG_ENABLED == 1） ======================= */
 #ifndef LOG_ENABLED
 
@@ -45,7 +85,7 @@ typedef void (*LogCallback)(LogLevel level, const char *message, time_t timestam
  * @brief 初始化日志系统
  * @param logFilePath 日志文件路径，支持时间格式占位符。
  *        例："./logs/myapp_%Y-%M-%D_%h:%m:%s.log"
- * @param level 日志级别阈值
+ * @param level 日志级别阈值（各输出的默认接受级别，可由 LogSetOutputFilter 单独放宽或收紧）
  * @return 成功返回 0，失败返回 -1（日志将输出到 stderr）
  */
 int  InitLog(const char *logFilePath, LogLevel level);
@@ -72,6 +112,71 @@ void LogPrintfJSON(LogLevel level, const char *fmt, ...)
 #endif
     ;
 
+/**
+ * @brief 记录一条带源码位置的文本日志，通常通过 LOG_PRINTF 宏调用
+ * @param level 日志级别
+ * @param file  源文件（布局中的 %F）
+ * @param line  行号（布局中的 %l）
+ * @param fmt   格式化字符串
+ */
+void LogPrintfAt(LogLevel level, const char *file, int line, const char *fmt, ...)
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((format(printf, 4, 5)))
+#endif
+    ;
+
+#define LOG_PRINTF(level, ...)  LogPrintfAt(level, __FILE__, __LINE__, __VA_ARGS__)
+
+/**
+ * @brief 记录一条带分类标签的文本日志，供 LogSetOutputFilter 按标签路由
+ * @param level 日志级别
+ * @param tag   分类标签（布局中的 %C），最长 31 个字符
+ * @param fmt   格式化字符串
+ */
+void LogPrintfTag(LogLevel level, const char *tag, const char *fmt, ...)
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((format(printf, 3, 4)))
+#endif
+    ;
+
+/**
+ * @brief 判断该级别的记录当前是否会被写出，可在准备参数前调用以跳过开销
+ * @return 会写出返回 1，否则返回 0
+ */
+int  LogIsEnabled(LogLevel level);
+
+/**
+ * @brief 投递一条延迟渲染的文本日志：调用方只复制参数，正文由写线程调用 render 生成
+ * @param level   日志级别
+ * @param file    源文件（可为 NULL）
+ * @param line    源码行号
+ * @param render  渲染函数，同一格式应使用同一函数（LOG_DEDUP_FORMAT 以它区分格式）
+ * @param payload 参数序列化后的字节，调用返回后即可释放
+ * @param len     payload 长度
+ * @note 供 logio.hpp 等前端使用。共享环生产者进程中 render 在调用方执行。
+ */
+void LogSubmitDeferred(LogLevel level, const char *file, int line,
+                       LogRenderFn render, const void *payload, size_t len);
+
+/**
+ * @brief 预留一条延迟渲染记录，调用方把参数直接序列化进记录自身的分配，不再经过中间缓冲
+ * @param level  日志级别
+ * @param file   源文件（可为 NULL）
+ * @param line   源码行号
+ * @param render 渲染函数（同 LogSubmitDeferred）
+ * @param len    payload 长度
+ * @return 可写入 len 字节的缓冲；级别未被接受或分配失败返回 NULL，此时无需提交
+ * @note 写完后必须以 LogCommitDeferred 提交，时间戳取自预留时刻。
+ */
+void *LogReserveDeferred(LogLevel level, const char *file, int line,
+                         LogRenderFn render, size_t len);
+
+/**
+ * @brief 提交 LogReserveDeferred 预留的记录
+ * @param payload LogReserveDeferred 的返回值，NULL 时直接返回
+ */
+void LogCommitDeferred(void *payload);
+
 /**
  * @brief 添加一个输出流（控制台、stderr 等）
  * @param stream       文件指针
@@ -95,15 +200,158 @@ int  LogAddCallback(LogCallback cb, void *userdata);
  */
 int  LogRemoveOutput(int id);
 
+/**
+ * @brief 向当前线程的诊断上下文压入一个字段，之后该线程的每条日志都会携带它
+ * @param key   字段名
+ * @param value 字段值（立即复制）
+ * @return 成功返回 0，字段数或总长度超出上限返回 -1
+ */
+int  LogContextPush(const char *key, const char *value);
+
+/**
+ * @brief 弹出当前线程最近压入的上下文字段
+ */
+void LogContextPop(void);
+
+/**
+ * @brief 清空当前线程的诊断上下文
+ */
+void LogContextClear(void);
+
+/**
+ * @brief 设置当前线程名（布局中的 %N），未设置时自动采集系统线程名
+ * @param name 线程名，超过 15 个字符将被截断
+ */
+void LogSetThreadName(const char *name);
+
+/**
+ * @brief 设置输出目标的行布局，布局在此处编译，写线程直接执行
+ * @param id          输出目标 ID（0 为主文件输出）
+ * @param text_layout 文本消息布局，NULL 恢复默认 "[%L/%T] %X%m"
+ * @param json_layout JSON 消息布局，NULL 恢复默认
+ *        说明符：%T 时间  %u 微秒  %L 级别  %t 线程 ID  %N 线程名
+ *                %P 进程 ID  %F 源文件  %l 行号  %C 分类标签
+ *                %m 消息  %j JSON 转义后的消息
+ *                %X 上下文 "{k=v k=v} "  %J 上下文 JSON 成员 ,"k":"v"  %% 百分号
+ *        例："%T.%u %L [%t] %F:%l %m"
+ *        布局相同的输出对每条消息只渲染一次。
+ * @return 成功返回 0，失败返回 -1
+ */
+int  LogSetOutputLayout(int id, const char *text_layout, const char *json_layout);
+
+/**
+ * @brief 设置输出目标接受的级别与标签，被过滤的消息不会为该输出渲染
+ * @param id         输出目标 ID（0 为主文件输出）
+ * @param level_mask 级别位图，例如 LOG_LEVEL_MASK(LOG_LEVEL_ERROR)
+ *                   或 LOG_LEVEL_MASK_FROM(LOG_LEVEL_INFO)
+ * @param tag        非空时只接受 LogPrintfTag 以该标签记录的消息，NULL 不限
+ * @return 成功返回 0，失败返回 -1
+ * @note 新输出默认接受 InitLog 阈值及以上的级别；实际阈值为所有输出中最低的接受级别，
+ *       没有任何输出接受的级别会在调用方直接丢弃，不做格式化。
+ */
+int  LogSetOutputFilter(int id, unsigned level_mask, const char *tag);
+
+/**
+ * @brief 创建跨进程共享环，本进程写线程成为收集者（需先 InitLog）
+ * @param path  后备文件路径（例如 "/dev/shm/myapp.logring"），其他进程用
+ *              LogShmAttach(path) 附着；NULL 则创建匿名映射，仅由 fork
+ *              出的子进程继承
+ * @param slots 槽数（向上取整为 2 的幂），0 使用默认值 4096
+ * @return 成功返回 0，失败返回 -1
+ * @note 生产者直接在共享环中格式化，不加锁、不做系统调用；环满时丢弃记录。
+ *       所有记录由收集者统一写入其输出、参与滚动。
+ *       每个槽的数据区为 896 字节，由上下文字段、源文件名与正文共用，超出部分截断
+ *       （本进程内的记录正文最长 4095 字节）。
+ */
+int  LogShmCreate(const char *path, size_t slots);
+
+/**
+ * @brief 作为生产者附着到共享环，此后本进程的日志全部交给收集者写出
+ * @param path 收集者 LogShmCreate 使用的路径（本进程无需 InitLog）；
+ *             在 fork 出的子进程中传 NULL 以沿用继承的共享环（atfork 已自动处理，
+ *             再次调用直接返回 0）
+ * @return 成功返回 0，失败返回 -1
+ */
+int  LogShmAttach(const char *path);
+
 /**
  * @brief 设置文件滚动策略（仅对主文件输出生效）
  * @param mode              滚动模式
  * @param max_size_mb       当 mode == LOG_ROLL_SIZE 时的最大文件大小（MB）
  * @param time_interval_sec 当 mode == LOG_ROLL_TIME 时的滚动时间间隔（秒）
  *                          例如 3600 表示每小时一个新文件
+ * @note LOG_FORK_INHERIT 模式下只有父进程执行滚动，子进程在父进程轮转后按路径重新打开。
+ *       文件名格式含时间占位符时，子进程打开的是按它发现轮转的时间生成的文件名。
  */
 void LogSetRolling(LogRollMode mode, long max_size_mb, int time_interval_sec);
 
+/**
+ * @brief 在写线程中合并连续重复的记录，只写出第一条，随后补一行"上一条消息重复 N 次"
+ * @param mode      见 LogDedupMode
+ * @param window_ms 一轮合并的最长时间（毫秒），<= 0 使用默认 1000；
+ *                  到期后即使仍在重复也会写出汇总并重新开始
+ * @note LOG_DEDUP_FORMAT 按格式串地址匹配，应配合字符串字面量使用。
+ *       LogFlush 会立即写出待写的汇总。
+ */
+void LogSetDedup(LogDedupMode mode, int window_ms);
+
+/**
+ * @brief 在内存中保留最近渲染的记录，供 LogTailOpen / LogTailRead 读取
+ * @param records 保留的记录数（向上取整为 2 的幂），每条最长 512 字节
+ * @return 成功返回 0，失败返回 -1；已开启时直接返回 0
+ * @note 记录按默认布局渲染（不含换行）。环在 InitLog 重新初始化或进程退出前一直有效。
+ */
+int  LogTailEnable(size_t records);
+
+/**
+ * @brief 打开一个尾随游标
+ * @param cur     游标（由调用方持有，每个读者一个）
+ * @param backlog 从最近的多少条记录开始读，0 表示只读之后的新记录
+ * @return 成功返回 0，未开启尾随环返回 -1
+ */
+int  LogTailOpen(LogTailCursor *cur, size_t backlog);
+
+/**
+ * @brief 读取游标的下一条记录，不加锁，不阻塞写线程
+ * @param cur   游标
+ * @param buf   输出缓冲，结果以 '\0' 结尾（过长时截断）
+ * @param cap   缓冲大小
+ * @param level 可为 NULL，返回记录级别
+ * @return 记录长度；没有新记录返回 0；出错返回 -1。
+ *         读者过慢时被覆盖的记录会被跳过并累计到 cur->lost。
+ */
+int  LogTailRead(LogTailCursor *cur, char *buf, size_t cap, LogLevel *level);
+
+/**
+ * @brief 为主文件输出维护时间索引旁路文件（<日志文件>.idx），供 logio-slice 按时间截取
+ * @param enable         非零开启，0 关闭
+ * @param granularity_kb 相邻索引项之间至少间隔的 KB 数，0 表示每秒一项
+ * @return 成功返回 0，失败返回 -1
+ * @note 滚动时索引随日志文件一起改名。LOG_FORK_INHERIT 模式的子进程不维护索引（返回 -1），
+ *       共享文件的索引由父进程维护。
+ */
+int  LogSetTimeIndex(int enable, long granularity_kb);
+
+/**
+ * @brief 安装致命信号处理（SIGSEGV / SIGBUS / SIGFPE / SIGILL / SIGABRT）
+ * @return 成功返回 0，失败或平台不支持返回 -1
+ * @note 进程崩溃时，队列（及共享环）中尚未写出的记录按主文件输出的布局
+ *       以 write(2) 直接写入日志文件，不加锁、不分配内存、不使用 stdio，
+ *       随后恢复原有处理方式并重新投递信号。需在 InitLog 之后调用。
+ *       主文件输出被 LogRemoveOutput(0) 移除后，崩溃时不再写出任何内容。
+ */
+int  LogInstallCrashHandler(void);
+
+/**
+ * @brief 设置 fork() 后子进程的日志行为
+ * @param mode 见 LogForkMode
+ * @note InitLog 会注册 pthread_atfork：fork 前等待队列写空并刷新输出，
+ *       子进程重置锁，并在第一次记录日志时按 mode 重建写线程。
+ *       若已调用 LogShmCreate，子进程自动成为共享环生产者（LOG_FORK_DISABLE 除外）。
+ *       在输出回调中也可以调用 fork，此时不等待队列写空，子进程应尽快 exec 或 _exit。
+ */
+void LogSetForkMode(LogForkMode mode);
+
 /**
  * @brief 刷新异步日志队列（等待所有消息写完）
  */
@@ -115,10 +363,32 @@ void LogFlush(void);
 #define InitLog(path, level)                  ((void)0)
 #define LogPrintf(level, fmt, ...)            ((void)0)
 #define LogPrintfJSON(level, fmt, ...)        ((void)0)
+#define LogPrintfAt(level, file, line, fmt, ...) ((void)0)
+#define LOG_PRINTF(level, ...)                ((void)0)
+#define LogPrintfTag(level, tag, fmt, ...)    ((void)0)
+#define LogIsEnabled(level)                   (0)
+#define LogSubmitDeferred(level, file, line, render, payload, len) ((void)0)
+#define LogReserveDeferred(level, file, line, render, len) ((void*)0)
+#define LogCommitDeferred(payload)            ((void)0)
 #define LogAddOutputStream(stream, color)     ((void)0)
 #define LogAddCallback(cb, userdata)          ((void)0)
 #define LogRemoveOutput(id)                   ((void)0)
+#define LogSetOutputLayout(id, text, json)    ((void)0)
+#define LogSetOutputFilter(id, mask, tag)     ((void)0)
+#define LogContextPush(key, value)            ((void)0)
+#define LogContextPop()                       ((void)0)
+#define LogContextClear()                     ((void)0)
+#define LogSetThreadName(name)                ((void)0)
 #define LogSetRolling(mode, size, interval)   ((void)0)
+#define LogShmCreate(path, slots)             ((void)0)
+#define LogShmAttach(path)                    ((void)0)
+#define LogSetDedup(mode, window_ms)          ((void)0)
+#define LogTailEnable(records)                ((void)0)
+#define LogTailOpen(cur, backlog)             ((void)0)
+#define LogTailRead(cur, buf, cap, level)     ((void)0)
+#define LogSetTimeIndex(enable, gran)         ((void)0)
+#define LogInstallCrashHandler()              ((void)0)
+#define LogSetForkMode(mode)                  ((void)0)
 #define LogFlush()                            ((void)0)
 
 #endif /* LOG_ENABLED */
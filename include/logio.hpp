@@ -0,0 +1,384 @@
+/*
+ * logio.hpp —— logio 的 C++17 前端（仅头文件）
+ *
+ * 格式串使用 {} 占位符，在编译期解析并与参数逐个核对：
+ *   {}      任意支持的类型
+ *   {:x}    整数，小写十六进制（{:X} 为大写）
+ *   {:.N}   浮点数，保留 N 位小数（N 为 0-99）
+ *   {{ }}   字面花括号
+ * 占位符数量、参数类型或说明不匹配时编译失败。
+ *
+ * 调用方只按类型把参数直接序列化进 LogReserveDeferred 预留的队列记录（字符串直接复制内容，
+ * 不经过 c_str 或 vsnprintf），正文由写线程调用登记的渲染函数生成。
+ *
+ *   LOGIO_INFO("user {} took {}us", name, t);
+ *   logio::warn(LOGIO_FMT("retry {} of {}"), i, n);
+ */
+#ifndef LOGIO_HPP
+#define LOGIO_HPP
+
+#include "logio.h"
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+/* 把字符串字面量包装成携带编译期格式串的类型 */
+#define LOGIO_FMT(s)                                                              \
+    ([] {                                                                         \
+        struct logio_fmt_ {                                                       \
+            static constexpr std::string_view value() { return s; }               \
+        };                                                                        \
+        return logio_fmt_{};                                                      \
+    }())
+
+/* 格式串是 __VA_ARGS__ 的第一项：取出它生成格式类型，整个参数列表原样传给 submit_macro
+ * 并由其丢弃第一项，因此无需 ##__VA_ARGS__，在 -std=c++17 -Wpedantic 下没有警告 */
+#define LOGIO_EXPAND_(x)         x
+#define LOGIO_FIRST_(fmt, ...)   fmt
+#define LOGIO_LOG(level, ...)                                                      \
+    ::logio::detail::submit_macro(level, __FILE__, __LINE__,                       \
+        LOGIO_FMT(LOGIO_EXPAND_(LOGIO_FIRST_(__VA_ARGS__, 0))), __VA_ARGS__)
+#define LOGIO_DEBUG(...)  LOGIO_LOG(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOGIO_INFO(...)   LOGIO_LOG(LOG_LEVEL_INFO,  __VA_ARGS__)
+#define LOGIO_WARN(...)   LOGIO_LOG(LOG_LEVEL_WARN,  __VA_ARGS__)
+#define LOGIO_ERROR(...)  LOGIO_LOG(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+namespace logio {
+namespace detail {
+
+/* ======================= 编译期格式解析 ======================= */
+
+enum class spec_kind { plain, hex, hex_upper, precision, invalid };
+
+struct spec {
+    spec_kind kind;
+    int       precision;
+};
+
+constexpr spec parse_spec(std::string_view s) {
+    if (s.empty()) return { spec_kind::plain, 0 };
+    if (s[0] != ':') return { spec_kind::invalid, 0 };
+    s.remove_prefix(1);
+    if (s == "x") return { spec_kind::hex, 0 };
+    if (s == "X") return { spec_kind::hex_upper, 0 };
+    if (s.size() >= 2 && s.size() <= 3 && s[0] == '.') {
+        int p = 0;
+        for (size_t i = 1; i < s.size(); i++) {
+            if (s[i] < '0' || s[i] > '9') return { spec_kind::invalid, 0 };
+            p = p * 10 + (s[i] - '0');
+        }
+        return { spec_kind::precision, p };
+    }
+    return { spec_kind::invalid, 0 };
+}
+
+/* 从 pos 开始找下一个占位符：literal 回调接收其前的字面文本，返回占位符说明，
+ * 到达结尾返回 invalid 且 pos == f.size()，格式错误返回 invalid 且 pos == npos */
+template <class Literal>
+constexpr spec next_placeholder(std::string_view f, size_t &pos, Literal &&literal) {
+    size_t start = pos;
+    while (pos < f.size()) {
+        char c = f[pos];
+        if ((c == '{' || c == '}') && pos + 1 < f.size() && f[pos + 1] == c) {
+            literal(f.substr(start, pos + 1 - start));   // 保留一个花括号
+            pos += 2;
+            start = pos;
+            continue;
+        }
+        if (c == '}') {
+            pos = std::string_view::npos;
+            return { spec_kind::invalid, 0 };
+        }
+        if (c == '{') {
+            literal(f.substr(start, pos - start));
+            size_t close = f.find('}', pos + 1);
+            size_t open = f.find('{', pos + 1);
+            if (close == std::string_view::npos || open < close) {
+                pos = std::string_view::npos;
+                return { spec_kind::invalid, 0 };
+            }
+            spec s = parse_spec(f.substr(pos + 1, close - pos - 1));
+            pos = s.kind == spec_kind::invalid ? std::string_view::npos : close + 1;
+            return s;
+        }
+        pos++;
+    }
+    literal(f.substr(start, pos - start));
+    return { spec_kind::invalid, 0 };
+}
+
+struct ignore_literal {
+    constexpr void operator()(std::string_view) const {}
+};
+
+/* 占位符个数，格式错误返回 -1 */
+constexpr int count_placeholders(std::string_view f) {
+    size_t pos = 0;
+    int n = 0;
+    for (;;) {
+        spec s = next_placeholder(f, pos, ignore_literal{});
+        if (pos == std::string_view::npos) return -1;
+        if (s.kind == spec_kind::invalid) return n;
+        n++;
+    }
+}
+
+/* 第 index 个占位符的说明 */
+constexpr spec nth_spec(std::string_view f, size_t index) {
+    size_t pos = 0;
+    spec s = { spec_kind::invalid, 0 };
+    for (size_t i = 0; i <= index; i++)
+        s = next_placeholder(f, pos, ignore_literal{});
+    return s;
+}
+
+/* ======================= 参数类型 ======================= */
+
+enum class arg_kind { boolean, character, signed_int, unsigned_int, floating, string, pointer, null, unsupported };
+
+template <class T>
+constexpr arg_kind kind_of() {
+    using U = std::decay_t<T>;
+    if constexpr (std::is_same_v<U, bool>) return arg_kind::boolean;
+    else if constexpr (std::is_same_v<U, char>) return arg_kind::character;
+    else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) return arg_kind::signed_int;
+    else if constexpr (std::is_integral_v<U>) return arg_kind::unsigned_int;
+    else if constexpr (std::is_floating_point_v<U>) return arg_kind::floating;
+    else if constexpr (std::is_same_v<U, std::nullptr_t>) return arg_kind::null;   // 先于字符串判断：nullptr 可转换为 string_view
+    else if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>) return arg_kind::string;
+    else if constexpr (std::is_convertible_v<const U&, std::string_view>) return arg_kind::string;
+    else if constexpr (std::is_pointer_v<U>) return arg_kind::pointer;
+    else return arg_kind::unsupported;
+}
+
+constexpr bool spec_accepts(spec s, arg_kind k) {
+    switch (s.kind) {
+        case spec_kind::plain:     return k != arg_kind::unsupported;
+        case spec_kind::hex:
+        case spec_kind::hex_upper: return k == arg_kind::signed_int || k == arg_kind::unsigned_int;
+        case spec_kind::precision: return k == arg_kind::floating;
+        default:                   return false;
+    }
+}
+
+template <class F, class... A, size_t... I>
+constexpr bool specs_match(std::index_sequence<I...>) {
+    return (spec_accepts(nth_spec(F::value(), I), kind_of<A>()) && ...);
+}
+
+/* ======================= 序列化 ======================= */
+
+/* 只有 const char* / char* 可能为空指针，其余可转换为 string_view 的类型直接转换 */
+template <class A>
+inline std::string_view as_string(const A &v) {
+    using U = std::decay_t<A>;
+    if constexpr (std::is_same_v<U, const char*> || std::is_same_v<U, char*>) {
+        const char *s = v;
+        return s ? std::string_view(s) : std::string_view("(null)");
+    } else {
+        return std::string_view(v);
+    }
+}
+
+constexpr size_t k_max_string = 4096;   // 超过单行缓冲的部分不会被写出
+
+template <class A>
+inline size_t encoded_size(const A &v) {
+    constexpr arg_kind k = kind_of<A>();
+    if constexpr (k == arg_kind::null) return 0;
+    else if constexpr (k == arg_kind::boolean || k == arg_kind::character) return 1;
+    else if constexpr (k == arg_kind::string) {
+        size_t n = as_string(v).size();
+        return sizeof(uint32_t) + (n < k_max_string ? n : k_max_string);
+    } else return 8;
+}
+
+template <class A>
+inline char *encode(char *d, const A &v) {
+    constexpr arg_kind k = kind_of<A>();
+    if constexpr (k == arg_kind::null) {
+        (void)v;
+        return d;
+    } else if constexpr (k == arg_kind::boolean || k == arg_kind::character) {
+        *d = static_cast<char>(v);
+        return d + 1;
+    } else if constexpr (k == arg_kind::signed_int) {
+        int64_t x = static_cast<int64_t>(v);
+        std::memcpy(d, &x, 8);
+        return d + 8;
+    } else if constexpr (k == arg_kind::unsigned_int) {
+        uint64_t x = static_cast<uint64_t>(v);
+        std::memcpy(d, &x, 8);
+        return d + 8;
+    } else if constexpr (k == arg_kind::floating) {
+        double x = static_cast<double>(v);
+        std::memcpy(d, &x, 8);
+        return d + 8;
+    } else if constexpr (k == arg_kind::pointer) {
+        uint64_t x = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(v));
+        std::memcpy(d, &x, 8);
+        return d + 8;
+    } else {
+        std::string_view s = as_string(v);
+        uint32_t n = static_cast<uint32_t>(s.size() < k_max_string ? s.size() : k_max_string);
+        std::memcpy(d, &n, sizeof(n));
+        std::memcpy(d + sizeof(n), s.data(), n);
+        return d + sizeof(n) + n;
+    }
+}
+
+/* ======================= 写线程渲染 ======================= */
+
+struct sink {
+    char *d;
+    char *end;   // 预留结尾 '\0'
+
+    void put(const char *s, size_t n) {
+        size_t room = static_cast<size_t>(end - d);
+        if (n > room) n = room;
+        std::memcpy(d, s, n);
+        d += n;
+    }
+    void put(std::string_view s) { put(s.data(), s.size()); }
+};
+
+inline void put_integer(sink &o, uint64_t v, bool negative, spec s) {
+    char tmp[24];
+    char *p = tmp;
+    if (negative) *p++ = '-';
+    int base = (s.kind == spec_kind::hex || s.kind == spec_kind::hex_upper) ? 16 : 10;
+    char *e = std::to_chars(p, tmp + sizeof(tmp), v, base).ptr;
+    if (s.kind == spec_kind::hex_upper)
+        for (char *c = p; c < e; c++)
+            if (*c >= 'a' && *c <= 'f') *c = static_cast<char>(*c - 'a' + 'A');
+    o.put(tmp, static_cast<size_t>(e - tmp));
+}
+
+/* 从 p 读出一个 A 类型的参数并按说明写入 o，返回下一个参数的位置 */
+template <class A>
+inline const char *render_arg(sink &o, const char *p, spec s) {
+    using U = std::decay_t<A>;
+    constexpr arg_kind k = kind_of<A>();
+    if constexpr (k == arg_kind::null) {
+        o.put(std::string_view("(null)"));
+        return p;
+    } else if constexpr (k == arg_kind::boolean) {
+        o.put(*p ? std::string_view("true") : std::string_view("false"));
+        return p + 1;
+    } else if constexpr (k == arg_kind::character) {
+        o.put(p, 1);
+        return p + 1;
+    } else if constexpr (k == arg_kind::signed_int) {
+        int64_t x;
+        std::memcpy(&x, p, 8);
+        if (s.kind == spec_kind::plain) {
+            uint64_t mag = x < 0 ? 0 - static_cast<uint64_t>(x) : static_cast<uint64_t>(x);
+            put_integer(o, mag, x < 0, s);
+        } else {
+            /* 十六进制按原类型的位宽输出补码 */
+            put_integer(o, static_cast<std::make_unsigned_t<U>>(static_cast<U>(x)), false, s);
+        }
+        return p + 8;
+    } else if constexpr (k == arg_kind::unsigned_int) {
+        uint64_t x;
+        std::memcpy(&x, p, 8);
+        put_integer(o, x, false, s);
+        return p + 8;
+    } else if constexpr (k == arg_kind::floating) {
+        double x;
+        std::memcpy(&x, p, 8);
+        char tmp[64];
+        int n;
+        if (s.kind == spec_kind::precision)
+            n = std::snprintf(tmp, sizeof(tmp), "%.*f", s.precision, x);
+        else
+            n = std::snprintf(tmp, sizeof(tmp), "%g", x);
+        if (n > 0) o.put(tmp, static_cast<size_t>(n) < sizeof(tmp) ? static_cast<size_t>(n) : sizeof(tmp) - 1);
+        return p + 8;
+    } else if constexpr (k == arg_kind::pointer) {
+        uint64_t x;
+        std::memcpy(&x, p, 8);
+        o.put("0x", 2);
+        put_integer(o, x, false, { spec_kind::hex, 0 });
+        return p + 8;
+    } else {
+        uint32_t n;
+        std::memcpy(&n, p, sizeof(n));
+        o.put(p + sizeof(n), n);
+        return p + sizeof(n) + n;
+    }
+}
+
+/* 每个 <格式, 参数类型> 组合实例化一个渲染函数，写线程通过它生成正文 */
+template <class F, class... A>
+size_t render(const void *payload, size_t len, char *buf, size_t cap) {
+    (void)len;
+    if (cap == 0) return 0;
+    constexpr std::string_view f = F::value();
+    sink o{ buf, buf + cap - 1 };
+    auto literal = [&o](std::string_view s) { o.put(s); };
+    const char *p = static_cast<const char*>(payload);
+    size_t pos = 0;
+    ((p = render_arg<A>(o, p, next_placeholder(f, pos, literal))), ...);
+    (void)p;
+    next_placeholder(f, pos, literal);   // 最后一个占位符之后的文本
+    *o.d = '\0';
+    return static_cast<size_t>(o.d - buf);
+}
+
+template <class F, class... A>
+void submit(LogLevel level, const char *file, int line, F, const A &...args) {
+    static_assert(count_placeholders(F::value()) >= 0,
+                  "logio: 格式串中的花括号不匹配或占位符说明无效");
+    static_assert(count_placeholders(F::value()) == static_cast<int>(sizeof...(A)),
+                  "logio: 占位符数量与参数数量不一致");
+    static_assert(((kind_of<A>() != arg_kind::unsupported) && ...),
+                  "logio: 不支持的参数类型（可用整数、浮点、bool、char、字符串、指针与 nullptr）");
+    static_assert(specs_match<F, A...>(std::index_sequence_for<A...>{}),
+                  "logio: 占位符说明与参数类型不符");
+
+#ifndef LOG_ENABLED
+    if (!LogIsEnabled(level)) return;
+
+    /* 参数直接序列化进队列记录自身的分配 */
+    size_t total = (size_t(0) + ... + encoded_size(args));
+    void *buf = LogReserveDeferred(level, file, line, &render<F, A...>, total);
+    if (!buf) return;
+    char *d = static_cast<char*>(buf);
+    ((d = encode(d, args)), ...);
+    (void)d;
+    LogCommitDeferred(buf);
+#else
+    /* 日志已剔除，只保留上面的编译期检查 */
+    (void)level; (void)file; (void)line;
+    ((void)args, ...);
+#endif
+}
+
+/* LOGIO_* 宏把格式串字面量同时作为第一个参数传入，这里丢弃 */
+template <class F, class S, class... A>
+inline void submit_macro(LogLevel level, const char *file, int line, F fmt, const S &, const A &...args) {
+    submit(level, file, line, fmt, args...);
+}
+
+} // namespace detail
+
+/* logio::info(LOGIO_FMT("..."), args...)；需要源文件与行号时使用 LOGIO_INFO 等宏 */
+template <class F, class... A>
+inline void debug(F fmt, const A &...args) { detail::submit(LOG_LEVEL_DEBUG, nullptr, 0, fmt, args...); }
+template <class F, class... A>
+inline void info(F fmt, const A &...args)  { detail::submit(LOG_LEVEL_INFO, nullptr, 0, fmt, args...); }
+template <class F, class... A>
+inline void warn(F fmt, const A &...args)  { detail::submit(LOG_LEVEL_WARN, nullptr, 0, fmt, args...); }
+template <class F, class... A>
+inline void error(F fmt, const A &...args) { detail::submit(LOG_LEVEL_ERROR, nullptr, 0, fmt, args...); }
+
+} // namespace logio
+
+#endif /* LOGIO_HPP */
@@ -1,3 +1,7 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+  #define _GNU_SOURCE            /* pthread_getname_np */
+#endif
+
 #include "logio.h"
 
 #include <stdlib.h>
@@ -37,6 +41,26 @@
   #define vsnprintf_impl vsnprintf
 #endif
 
+#if defined(__linux__)
+  #include <sys/syscall.h>   /* SYS_gettid */
+#endif
+
+#if !defined(_WIN32)
+  #include <sys/mman.h>      /* mmap：跨进程共享环 */
+  #include <fcntl.h>
+  #include <signal.h>        /* kill */
+  #ifndef MAP_ANONYMOUS
+    #define MAP_ANONYMOUS MAP_ANON
+  #endif
+#endif
+
+/* 线程局部存储 */
+#if defined(_MSC_VER)
+  #define LOG_TLS __declspec(thread)
+#else
+  #define LOG_TLS __thread
+#endif
+
 /* 线程相关（使用 pthread，Windows 下需链接 pthread 库） */
 #include <pthread.h>
 #define LOG_MUTEX_T            pthread_mutex_t
@@ -49,16 +73,43 @@
 #define LOG_COND_INIT(c)       pthread_cond_init(c, NULL)
 #define LOG_COND_WAIT(c, m)    pthread_cond_wait(c, m)
 #define LOG_COND_SIGNAL(c)     pthread_cond_signal(c)
+#define LOG_COND_BROADCAST(c)  pthread_cond_broadcast(c)
 #define LOG_COND_DESTROY(c)    pthread_cond_destroy(c)
 
 #define LOG_THREAD_T           pthread_t
 #define LOG_THREAD_CREATE(t, f, a)  pthread_create(t, NULL, f, a)
 #define LOG_THREAD_JOIN(t)     pthread_join(t, NULL)
 
+/* 原子操作（GCC / Clang 内建，跨进程共享内存中同样有效） */
+#define LOG_ATOMIC_LOAD(p)          __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define LOG_ATOMIC_STORE(p, v)      __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define LOG_ATOMIC_CAS(p, e, d)     __atomic_compare_exchange_n(p, e, d, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define LOG_ATOMIC_ADD(p, v)        __atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+#define LOG_ATOMIC_XCHG(p, v)       __atomic_exchange_n(p, v, __ATOMIC_ACQ_REL)
+
 /* ======================= 内部常量 ======================= */
 #define MAX_OUTPUTS       16            // 最大输出目标数
 #define MAX_QUEUE_SIZE    4096          // 异步队列容量
 #define TIMESTAMP_LEN     32            // 时间字符串缓冲
+#define LINE_BUF_LEN      4096          // 单行渲染缓冲
+#define MAX_LAYOUTS       16            // 布局表容量（含两个默认布局）
+#define MAX_LAYOUT_OPS    64            // 单个布局编译后的最大操作数
+#define MAX_CTX_FIELDS    8             // 每线程上下文字段上限
+#define CTX_BUF_LEN       256           // 每线程上下文缓冲（key\0value\0...）
+#define THREAD_NAME_LEN   16            // 线程名缓冲（与 pthread 限制一致）
+#define TAG_LEN           32            // 分类标签缓冲
+#define SHM_SLOT_DATA     896           // 共享环单槽数据区（上下文 + 源文件 + 正文）
+#define SHM_DEFAULT_SLOTS 4096          // 共享环默认槽数
+#define SHM_MAGIC         0x4F49474CU   // "LGIO"
+#define SHM_POLL_MS       10            // 收集者空闲时轮询共享环的间隔
+#define SHM_LOCAL_BURST   64            // 收集者连续写出本进程记录的上限，之后先取一次共享环
+#define SHM_STALL_CHECK_MS 100          // 槽占用未发布超过该时间后检查占用者是否存活
+#define SHM_STALL_MS      1000          // 占用者未登记时，超过该时间视为已退出
+#define TAIL_SLOT_LEN     512           // 尾随环单条记录的最大长度
+#define DEDUP_DEFAULT_MS  1000          // 重复合并的默认时间窗口
+
+#define LAYOUT_DEFAULT_TEXT  0          // 默认文本布局索引
+#define LAYOUT_DEFAULT_JSON  1          // 默认 JSON 布局索引
 
 /* ======================= 内部类型 ======================= */
 
@@ -66,11 +117,56 @@
 typedef struct log_msg {
     LogLevel  level;
     time_t    timestamp;
+    long      usec;          // 时间戳的微秒部分
+    unsigned long tid;       // 生产者线程 ID
+    int       pid;           // 生产者进程 ID
+    const char *file;        // 源文件（LogPrintfAt，可为 NULL）
+    uint64_t  fmt_key;       // 格式串地址，仅作按格式去重的键，不解引用
+    LogRenderFn render;      // 延迟渲染（LogSubmitDeferred），NULL 表示 text 即正文
+    const void *payload;     // 延迟渲染的参数（与 text 同一块分配）
+    size_t    payload_len;
+    int       line;          // 源码行号
+    char      thread_name[THREAD_NAME_LEN]; // 生产者线程名
+    char      tag[TAG_LEN];  // 分类标签（LogPrintfTag，可为空）
+    char     *ctx;           // 上下文快照（与 text 同一块分配），key\0value\0...
+    size_t    ctx_len;
     char     *text;          // 堆分配，消息正文（JSON 已转义，或普通文本）
     int       is_json;       // 1: JSON, 0: 普通文本
     struct log_msg *next;
 } log_msg;
 
+/* 布局操作类型：布局串在配置时编译为操作序列，写线程按序执行 */
+typedef enum {
+    LAYOUT_OP_LITERAL = 0,   // 原样复制一段字面量
+    LAYOUT_OP_TIME,          // %T  本地时间 YYYY-mm-dd HH:MM:SS
+    LAYOUT_OP_USEC,          // %u  微秒（6 位）
+    LAYOUT_OP_LEVEL,         // %L  级别名
+    LAYOUT_OP_THREAD,        // %t  线程 ID
+    LAYOUT_OP_FILE,          // %F  源文件名（不含目录）
+    LAYOUT_OP_LINE,          // %l  源码行号
+    LAYOUT_OP_MSG,           // %m  消息正文
+    LAYOUT_OP_MSG_JSON,      // %j  JSON 转义后的消息正文
+    LAYOUT_OP_THREAD_NAME,   // %N  线程名
+    LAYOUT_OP_CTX,           // %X  上下文文本 "{k=v k=v} "，无上下文时为空
+    LAYOUT_OP_CTX_JSON,      // %J  上下文 JSON 成员 ,"k":"v"，无上下文时为空
+    LAYOUT_OP_TAG,           // %C  分类标签
+    LAYOUT_OP_PID            // %P  进程 ID
+} layout_op_kind;
+
+typedef struct layout_op {
+    uint8_t   kind;
+    uint16_t  off;           // 字面量在 pattern 中的偏移
+    uint16_t  len;           // 字面量长度
+} layout_op;
+
+/* 已编译布局，相同布局串的输出共享同一项及其渲染缓冲 */
+typedef struct log_layout {
+    char      *pattern;      // 布局串副本（字面量指向其中）
+    layout_op  ops[MAX_LAYOUT_OPS];
+    int        op_count;
+    char      *line;         // 渲染缓冲（LINE_BUF_LEN）
+} log_layout;
+
 /* 输出目标 */
 typedef struct log_output {
     LogOutputType type;
@@ -85,24 +181,128 @@ typedef struct log_output {
     } target;
     int  color_enabled;       // 仅对 stream 且 isatty 时有效
     int  is_tty;              // 记录 stream 是否为终端
-    char reserved[4];         // 对齐填充
+    int  layout[2];           // 文本 / JSON 消息使用的布局索引
+    unsigned level_mask;      // 接受的级别位图（LOG_LEVEL_MASK）
+    char tag[TAG_LEN];        // 非空时只接受该标签的消息
 } log_output;
 
+/* 共享环中的一条记录，生产者进程直接在槽内格式化 */
+typedef struct shm_slot {
+    uint64_t  seq;           // 槽序号：== pos 可写，== pos + 1 已发布
+    int32_t   owner;         // 占用该槽的生产者进程，发布前写入，收集者释放时清零
+    int32_t   level;
+    int32_t   is_json;
+    int32_t   pad;           // 保持 timestamp 8 字节对齐
+    int64_t   timestamp;
+    int32_t   usec;
+    int32_t   pid;
+    uint64_t  tid;
+    uint64_t  fmt_key;       // 生产者进程内的格式串地址
+    int32_t   line;
+    uint16_t  ctx_len;
+    uint16_t  file_len;      // 含结尾 '\0'，0 表示无源文件
+    char      thread_name[THREAD_NAME_LEN];
+    char      tag[TAG_LEN];
+    char      data[SHM_SLOT_DATA];   // ctx | file\0 | text\0
+} shm_slot;
+
+/* 共享环头部：多生产者（跨进程）/ 单消费者（收集者写线程） */
+typedef struct shm_ring {
+    uint32_t  magic;
+    uint32_t  slot_size;     // sizeof(shm_slot)，附着时校验
+    uint64_t  slot_count;    // 2 的幂
+    uint32_t  admit_mask;    // 收集者发布的准入位图
+    int32_t   collector_pid;
+    uint64_t  dropped;       // 环满时丢弃的记录数
+    char      pad0[32];
+    uint64_t  enqueue_pos;   // 生产者竞争推进，独占缓存行
+    char      pad1[56];
+    uint64_t  dequeue_pos;   // 仅收集者推进
+    char      pad2[56];
+    shm_slot  slots[];
+} shm_ring;
+
+typedef enum {
+    LOG_SHM_NONE = 0,
+    LOG_SHM_COLLECTOR,       // 本进程写线程消费共享环
+    LOG_SHM_PRODUCER         // 本进程只向共享环写入
+} log_shm_role;
+
+/* 尾随环的一个槽：seq 为奇数表示写入中，2n+2 表示第 n 条记录已发布 */
+typedef struct tail_slot {
+    uint64_t  seq;
+    int32_t   level;
+    uint32_t  len;
+    char      line[TAIL_SLOT_LEN];
+} tail_slot;
+
+/* 线程局部状态：线程标识与诊断上下文（MDC） */
+typedef struct log_tls {
+    unsigned long tid;
+    int           name_ready;                // name 已采集或已由用户设置
+    char          name[THREAD_NAME_LEN];
+    int           depth;                     // 已压入的字段数
+    size_t        ctx_len;
+    size_t        ctx_off[MAX_CTX_FIELDS];   // 各字段起点，供 Pop 回退
+    char          ctx[CTX_BUF_LEN];
+} log_tls;
+
+static LOG_TLS log_tls t_log;
+
 /* 全局日志上下文（单例） */
 typedef struct log_ctx {
     LOG_MUTEX_T       mutex;           // 保护本结构所有字段
     LOG_COND_T        cond;            // 队列非空条件
     int               initialized;     // 是否已初始化
     LogLevel          level;           // 阈值
+    volatile unsigned admit_mask;      // 准入位图：所有输出级别位图之并
 
     /* 异步队列 */
-    log_msg          *queue_head;
+    log_msg          *queue_head;      // 崩溃处理会不加锁地整体摘下，取出时用 CAS
     log_msg          *queue_tail;
     int               queue_count;
     int               quit;            // 后台线程退出标志
+    int               in_callback;     // 写线程正在执行输出回调（此时持有锁）
+    int               writing;         // 写线程正在写出一条已出队的消息
+    int               idle_waiters;    // 等待队列写空的线程数（LogFlush / fork）
 
     /* 后台线程 */
     LOG_THREAD_T      thread;
+    int               thread_started;  // 后台线程是否在运行
+    int               pid;             // 本进程 ID
+
+    /* 重复消息合并（在写出路径中，持有锁时访问） */
+    LogDedupMode      dedup_mode;
+    long              dedup_window_ms;
+    uint64_t          dedup_hash;      // 上一条写出记录的指纹
+    long long         dedup_start_ms;  // 本轮重复开始的时间
+    unsigned long     dedup_count;     // 本轮被合并的条数
+    log_msg           dedup_last;      // 最近一条被合并记录的头部（不含正文）
+
+    /* 最近记录的尾随环（写线程写，读者无锁读取） */
+    tail_slot        *tail;
+    uint64_t          tail_cap;        // 2 的幂
+    uint64_t          tail_head;       // 已发布的记录数
+
+    /* 时间索引（主文件的 .idx 旁路文件） */
+    int               index_enabled;
+    long              index_gran;      // 相邻索引项之间至少间隔的字节数
+    FILE             *index_file;
+    time_t            index_last_ts;   // 最近一个索引项的时间戳
+    long              index_pending;   // 自最近索引项以来写出的字节数
+
+    /* 崩溃处理 */
+    volatile int      file_fd;         // 主文件输出的描述符，供信号处理直接 write
+    long              crash_gmtoff;    // 安装崩溃处理时的本地时区偏移（秒）
+    volatile int      crashing;        // 崩溃处理已接管队列与共享环，写线程停止取出
+    volatile int      inflight;        // 写线程已取出、尚未写完一条记录（崩溃处理等待其写完）
+
+    /* fork 处理 */
+    LogForkMode       fork_mode;
+    volatile int      fork_resume;     // 子进程中尚未重建写线程
+    int               disabled;        // 本进程不再接受日志（禁用模式的子进程或写线程不可用）
+    int               roll_follower;   // 继承模式的子进程：不滚动，只跟随父进程重开文件
+    time_t            follow_check_ts; // 跟随者下次检查文件是否已轮转的时间
 
     /* 输出目标 */
     log_output        outputs[MAX_OUTPUTS];
@@ -117,6 +317,25 @@ typedef struct log_ctx {
     int               roll_interval;   // 秒
     time_t            next_roll_time;  // 下次滚动的时间戳（按时间滚动）
     char             *current_file_path; // 当前打开的文件路径
+
+    /* 输出布局（仅写线程渲染） */
+    log_layout        layouts[MAX_LAYOUTS];
+    int               layout_count;
+    time_t            time_cache_ts;   // time_cache 对应的秒
+    char              time_cache[TIMESTAMP_LEN];
+
+    /* 跨进程共享环 */
+    shm_ring         *shm;
+    size_t            shm_size;        // 映射长度
+    log_shm_role      shm_role;
+    char             *shm_path;        // 收集者创建的后备文件，退出时删除
+    shm_slot         *shm_scratch;     // 收集者复制槽内容用的缓冲
+    uint64_t          shm_dropped_seen; // 已报告的丢弃数
+    uint64_t          shm_stall_pos;   // 停滞槽的位置 + 1，0 表示没有停滞
+    long long         shm_stall_since; // 开始停滞的单调时钟毫秒数
+    uint64_t          shm_skipped;     // 因生产者退出而跳过、尚未报告的槽数
+
+    char             *render_buf;      // 写线程渲染延迟记录用的缓冲
 } log_ctx;
 
 static log_ctx g_ctx;   // 全局单例，零初始化
@@ -242,163 +461,960 @@ static char *parse_filefmt(const char *filefmt, time_t t) {
     return result;
 }
 
-/* JSON 字符串转义（就地扩展，需预分配足够空间） */
-static char *json_escape(const char *src) {
-    size_t len = strlen(src);
-    size_t cap = len * 2 + 4;  // 粗略估计
-    char *dst = (char*)malloc(cap);
-    if (!dst) return NULL;
-    char *d = dst;
-    for (const char *s = src; *s; s++) {
+/* ======================= 布局编译与渲染 ======================= */
+
+static const char *const k_level_names[] = { "DEBUG", "INFO", "WARN", "ERROR" };
+
+static const char *level_name_of(LogLevel level) {
+    return (level >= 0 && level <= 3) ? k_level_names[level] : "UNKNOWN";
+}
+
+/* 向 [*d, end) 追加 n 字节，超出部分截断 */
+static void put_bytes(char **d, char *end, const char *s, size_t n) {
+    size_t room = (size_t)(end - *d);
+    if (n > room) n = room;
+    memcpy(*d, s, n);
+    *d += n;
+}
+
+/* 追加十进制无符号整数，width > 0 时左侧补零 */
+static void put_uint(char **d, char *end, unsigned long v, int width) {
+    char tmp[24];
+    int n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v && n < (int)sizeof(tmp));
+    while (n < width && n < (int)sizeof(tmp)) tmp[n++] = '0';
+    while (n > 0 && *d < end) *(*d)++ = tmp[--n];
+}
+
+/* 追加 JSON 转义后的字符串，转义序列不会被截断 */
+static void put_json(char **d, char *end, const char *s) {
+    for (; *s; s++) {
+        char esc = 0;
         switch (*s) {
-            case '"':  *d++ = '\\'; *d++ = '"'; break;
-            case '\\': *d++ = '\\'; *d++ = '\\'; break;
-            case '\n': *d++ = '\\'; *d++ = 'n'; break;
-            case '\r': *d++ = '\\'; *d++ = 'r'; break;
-            case '\t': *d++ = '\\'; *d++ = 't'; break;
-            default:   *d++ = *s;
+            case '"':  esc = '"';  break;
+            case '\\': esc = '\\'; break;
+            case '\n': esc = 'n';  break;
+            case '\r': esc = 'r';  break;
+            case '\t': esc = 't';  break;
+            default:   break;
+        }
+        if (esc) {
+            if (end - *d < 2) return;
+            *(*d)++ = '\\';
+            *(*d)++ = esc;
+        } else {
+            if (*d >= end) return;
+            *(*d)++ = *s;
+        }
+    }
+}
+
+/* 编译布局串到 lay，成功返回 0 */
+static int layout_compile(log_layout *lay, const char *pattern) {
+    size_t plen = strlen(pattern);
+    if (plen > UINT16_MAX) return -1;
+    char *copy = strdup(pattern);
+    char *line = (char*)malloc(LINE_BUF_LEN);
+    if (!copy || !line) {
+        free(copy);
+        free(line);
+        return -1;
+    }
+
+    int n = 0;
+    size_t lit_start = 0;
+    size_t i = 0;
+    while (i <= plen) {
+        int kind = -1;
+        size_t skip = 1;
+        if (i == plen) {
+            kind = -2;                        /* 结尾：收尾字面量 */
+        } else if (copy[i] == '%' && i + 1 < plen) {
+            skip = 2;
+            switch (copy[i + 1]) {
+                case 'T': kind = LAYOUT_OP_TIME;     break;
+                case 'u': kind = LAYOUT_OP_USEC;     break;
+                case 'L': kind = LAYOUT_OP_LEVEL;    break;
+                case 't': kind = LAYOUT_OP_THREAD;   break;
+                case 'F': kind = LAYOUT_OP_FILE;     break;
+                case 'l': kind = LAYOUT_OP_LINE;     break;
+                case 'm': kind = LAYOUT_OP_MSG;      break;
+                case 'j': kind = LAYOUT_OP_MSG_JSON; break;
+                case 'N': kind = LAYOUT_OP_THREAD_NAME; break;
+                case 'X': kind = LAYOUT_OP_CTX;      break;
+                case 'J': kind = LAYOUT_OP_CTX_JSON; break;
+                case 'C': kind = LAYOUT_OP_TAG;      break;
+                case 'P': kind = LAYOUT_OP_PID;      break;
+                case '%': kind = LAYOUT_OP_LITERAL;  break;  /* %% → 单个 % */
+                default:  break;                              /* 未知说明符按字面量保留 */
+            }
+        }
+        if (kind == -1) { i++; continue; }
+
+        /* 先收尾之前的字面量；%% 的第二个 % 并入下一段字面量 */
+        size_t lit_end = (kind == LAYOUT_OP_LITERAL) ? i + 1 : i;
+        if (lit_end > lit_start) {
+            if (n >= MAX_LAYOUT_OPS) goto too_many;
+            lay->ops[n].kind = LAYOUT_OP_LITERAL;
+            lay->ops[n].off = (uint16_t)lit_start;
+            lay->ops[n].len = (uint16_t)(lit_end - lit_start);
+            n++;
         }
+        if (kind == -2) break;
+        if (kind != LAYOUT_OP_LITERAL) {
+            if (n >= MAX_LAYOUT_OPS) goto too_many;
+            lay->ops[n].kind = (uint8_t)kind;
+            lay->ops[n].off = 0;
+            lay->ops[n].len = 0;
+            n++;
+        }
+        i += skip;
+        lit_start = i;
     }
+
+    lay->pattern = copy;
+    lay->line = line;
+    lay->op_count = n;
+    return 0;
+
+too_many:
+    free(copy);
+    free(line);
+    return -1;
+}
+
+/* 查找或编译布局，返回布局表索引，失败返回 -1（需持有锁） */
+static int layout_intern(const char *pattern) {
+    for (int i = 0; i < g_ctx.layout_count; i++) {
+        if (strcmp(g_ctx.layouts[i].pattern, pattern) == 0)
+            return i;
+    }
+    if (g_ctx.layout_count >= MAX_LAYOUTS) return -1;
+    if (layout_compile(&g_ctx.layouts[g_ctx.layout_count], pattern) != 0)
+        return -1;
+    return g_ctx.layout_count++;
+}
+
+/* 返回消息时间的字符串形式，按秒缓存，避免每条消息都调用 localtime_r */
+static const char *log_time_str(time_t t) {
+    if (t != g_ctx.time_cache_ts || g_ctx.time_cache[0] == '\0') {
+        struct tm tm_buf;
+        localtime_r(&t, &tm_buf);
+        strftime(g_ctx.time_cache, sizeof(g_ctx.time_cache), "%Y-%m-%d %H:%M:%S", &tm_buf);
+        g_ctx.time_cache_ts = t;
+    }
+    return g_ctx.time_cache;
+}
+
+/* 不依赖 localtime_r 的时间格式化（可在信号处理中调用），gmtoff 为本地时区偏移秒数 */
+static void format_time_safe(time_t t, long gmtoff, char *out) {
+    int64_t secs = (int64_t)t + gmtoff;
+    int64_t days = secs / 86400;
+    int64_t rem = secs % 86400;
+    if (rem < 0) { rem += 86400; days--; }
+
+    /* 由 1970-01-01 起的天数换算公历日期 */
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    int64_t doe = days - era * 146097;
+    int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int64_t mp = (5 * doy + 2) / 153;
+    int64_t day = doy - (153 * mp + 2) / 5 + 1;
+    int64_t mon = mp < 10 ? mp + 3 : mp - 9;
+    int64_t year = yoe + era * 400 + (mon <= 2);
+
+    char *d = out;
+    char *end = out + TIMESTAMP_LEN - 1;
+    put_uint(&d, end, (unsigned long)year, 4);  *d++ = '-';
+    put_uint(&d, end, (unsigned long)mon, 2);   *d++ = '-';
+    put_uint(&d, end, (unsigned long)day, 2);   *d++ = ' ';
+    put_uint(&d, end, (unsigned long)(rem / 3600), 2);       *d++ = ':';
+    put_uint(&d, end, (unsigned long)(rem / 60 % 60), 2);    *d++ = ':';
+    put_uint(&d, end, (unsigned long)(rem % 60), 2);
     *d = '\0';
-    return dst;
+}
+
+/* 按已编译布局渲染一行（含结尾换行），返回字节数。
+ * signal_safe 为 1 时不访问时间缓存、不调用 localtime_r，可在信号处理中使用 */
+static size_t layout_render(const log_layout *lay, const log_msg *msg, char *buf, size_t cap,
+                            int signal_safe) {
+    char *d = buf;
+    char *end = buf + cap - 1;   /* 为换行预留一个字节 */
+    for (int i = 0; i < lay->op_count; i++) {
+        const layout_op *op = &lay->ops[i];
+        switch (op->kind) {
+            case LAYOUT_OP_LITERAL:
+                put_bytes(&d, end, lay->pattern + op->off, op->len);
+                break;
+            case LAYOUT_OP_TIME: {
+                char safe_ts[TIMESTAMP_LEN];
+                const char *ts = safe_ts;
+                if (signal_safe)
+                    format_time_safe(msg->timestamp, g_ctx.crash_gmtoff, safe_ts);
+                else
+                    ts = log_time_str(msg->timestamp);
+                put_bytes(&d, end, ts, strlen(ts));
+                break;
+            }
+            case LAYOUT_OP_USEC:
+                put_uint(&d, end, (unsigned long)msg->usec, 6);
+                break;
+            case LAYOUT_OP_LEVEL: {
+                const char *name = level_name_of(msg->level);
+                put_bytes(&d, end, name, strlen(name));
+                break;
+            }
+            case LAYOUT_OP_THREAD:
+                put_uint(&d, end, msg->tid, 0);
+                break;
+            case LAYOUT_OP_FILE:
+                if (msg->file) {
+                    const char *base = strrchr(msg->file, '/');
+                    base = base ? base + 1 : msg->file;
+                    put_bytes(&d, end, base, strlen(base));
+                }
+                break;
+            case LAYOUT_OP_LINE:
+                put_uint(&d, end, (unsigned long)(msg->line > 0 ? msg->line : 0), 0);
+                break;
+            case LAYOUT_OP_MSG:
+                put_bytes(&d, end, msg->text, strlen(msg->text));
+                break;
+            case LAYOUT_OP_MSG_JSON:
+                put_json(&d, end, msg->text);
+                break;
+            case LAYOUT_OP_THREAD_NAME:
+                put_bytes(&d, end, msg->thread_name, strlen(msg->thread_name));
+                break;
+            case LAYOUT_OP_TAG:
+                put_bytes(&d, end, msg->tag, strlen(msg->tag));
+                break;
+            case LAYOUT_OP_PID:
+                put_uint(&d, end, (unsigned long)(msg->pid > 0 ? msg->pid : 0), 0);
+                break;
+            case LAYOUT_OP_CTX:
+            case LAYOUT_OP_CTX_JSON: {
+                if (msg->ctx_len == 0) break;
+                int json = (op->kind == LAYOUT_OP_CTX_JSON);
+                const char *p = msg->ctx;
+                const char *ctx_end = msg->ctx + msg->ctx_len;
+                if (!json) put_bytes(&d, end, "{", 1);
+                for (int first = 1; p < ctx_end; first = 0) {
+                    const char *key = p;
+                    const char *val = key + strlen(key) + 1;
+                    p = val + strlen(val) + 1;
+                    if (json) {
+                        put_bytes(&d, end, ",\"", 2);
+                        put_json(&d, end, key);
+                        put_bytes(&d, end, "\":\"", 3);
+                        put_json(&d, end, val);
+                        put_bytes(&d, end, "\"", 1);
+                    } else {
+                        if (!first) put_bytes(&d, end, " ", 1);
+                        put_bytes(&d, end, key, strlen(key));
+                        put_bytes(&d, end, "=", 1);
+                        put_bytes(&d, end, val, strlen(val));
+                    }
+                }
+                if (!json) put_bytes(&d, end, "} ", 2);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    *d++ = '\n';
+    return (size_t)(d - buf);
+}
+
+/* 为输出目标设置默认布局与过滤条件：默认接受 InitLog 阈值及以上的级别 */
+static void log_output_default_layout(log_output *out) {
+    out->layout[0] = LAYOUT_DEFAULT_TEXT;
+    out->layout[1] = LAYOUT_DEFAULT_JSON;
+    out->level_mask = LOG_LEVEL_MASK_FROM(g_ctx.level);
+    out->tag[0] = '\0';
+}
+
+/* ======================= 级别过滤 ======================= */
+
+/* 重新计算准入位图：所有输出级别位图之并，没有任何输出接受的级别在生产者处直接丢弃（需持有锁） */
+static void log_update_admit_mask(void) {
+    unsigned any = 0;
+    for (int i = 0; i < g_ctx.output_count; i++)
+        any |= g_ctx.outputs[i].level_mask;
+    g_ctx.admit_mask = g_ctx.disabled ? 0 : any;
+    if (g_ctx.shm_role == LOG_SHM_COLLECTOR)
+        LOG_ATOMIC_STORE(&g_ctx.shm->admit_mask, g_ctx.admit_mask);
+}
+
+static int log_admits(LogLevel level) {
+    if (g_ctx.disabled || g_ctx.crashing) return 0;
+    unsigned mask = (g_ctx.shm_role == LOG_SHM_PRODUCER) ?
+                    LOG_ATOMIC_LOAD(&g_ctx.shm->admit_mask) : g_ctx.admit_mask;
+    return (unsigned)level <= LOG_LEVEL_ERROR &&
+           (mask & LOG_LEVEL_MASK(level)) != 0;
+}
+
+/* 输出目标是否接受该消息 */
+static int log_output_accepts(const log_output *out, const log_msg *msg) {
+    if ((unsigned)msg->level > LOG_LEVEL_ERROR ||
+        !(out->level_mask & LOG_LEVEL_MASK(msg->level)))
+        return 0;
+    return out->tag[0] == '\0' || strcmp(out->tag, msg->tag) == 0;
 }
 
 /* ======================= 队列操作（内部使用，需持有锁） ======================= */
 
+static void log_msg_free(log_msg *msg) {
+    free(msg->text);
+    free(msg);
+}
+
 static void log_enqueue_msg(log_msg *msg) {
     /* 如果队列已满，等待消费者取出 */
-    while (g_ctx.queue_count >= MAX_QUEUE_SIZE && !g_ctx.quit) {
+    while (g_ctx.queue_count >= MAX_QUEUE_SIZE && !g_ctx.quit && !g_ctx.disabled) {
         LOG_COND_WAIT(&g_ctx.cond, &g_ctx.mutex);
     }
-    if (g_ctx.quit) {
-        /* 正在退出，丢弃消息 */
-        free(msg->text);
-        free(msg);
+    if (g_ctx.quit || g_ctx.disabled) {
+        /* 正在退出或没有写线程，丢弃消息 */
+        log_msg_free(msg);
         return;
     }
     msg->next = NULL;
+    /* 以原子存储发布，崩溃处理可能在其他线程中同时遍历队列 */
     if (g_ctx.queue_tail) {
-        g_ctx.queue_tail->next = msg;
+        LOG_ATOMIC_STORE(&g_ctx.queue_tail->next, msg);
     } else {
-        g_ctx.queue_head = msg;
+        LOG_ATOMIC_STORE(&g_ctx.queue_head, msg);
     }
     g_ctx.queue_tail = msg;
     g_ctx.queue_count++;
     LOG_COND_SIGNAL(&g_ctx.cond);   // 唤醒消费者
 }
 
+/* 取出队首消息，队列为空返回 NULL（不等待） */
 static log_msg *log_dequeue_msg(void) {
-    while (g_ctx.queue_head == NULL && !g_ctx.quit) {
-        LOG_COND_WAIT(&g_ctx.cond, &g_ctx.mutex);
-    }
-    if (g_ctx.quit && g_ctx.queue_head == NULL)
-        return NULL;
-    log_msg *msg = g_ctx.queue_head;
-    g_ctx.queue_head = msg->next;
-    if (g_ctx.queue_head == NULL)
+    if (LOG_ATOMIC_LOAD(&g_ctx.crashing))
+        return NULL;                // 队列已由崩溃处理接管
+    /* 崩溃处理不持有锁，以交换摘下整条队列；这里用 CAS 取队首，二者不会得到同一条消息 */
+    log_msg *msg = LOG_ATOMIC_LOAD(&g_ctx.queue_head);
+    do {
+        if (msg == NULL)
+            return NULL;
+    } while (!LOG_ATOMIC_CAS(&g_ctx.queue_head, &msg, msg->next));
+    if (msg->next == NULL)
         g_ctx.queue_tail = NULL;
     g_ctx.queue_count--;
     LOG_COND_SIGNAL(&g_ctx.cond);   // 通知生产者有空位
     return msg;
 }
 
-/* ======================= 后台写线程 ======================= */
+/* 等待队列清空且写线程没有正在写出的消息（需持有锁） */
+static void log_wait_idle(void) {
+    g_ctx.idle_waiters++;
+    while (g_ctx.queue_count > 0 || g_ctx.writing) {
+        LOG_COND_SIGNAL(&g_ctx.cond);
+        LOG_COND_WAIT(&g_ctx.cond, &g_ctx.mutex);
+    }
+    g_ctx.idle_waiters--;
+}
 
-static int log_write_to_outputs(log_msg *msg) {
-    /* 遍历 outputs 时需要持有锁，避免输出列表被修改 */
-    LOG_MUTEX_LOCK(&g_ctx.mutex);
+/* ======================= 线程局部状态 ======================= */
 
-    /* 根据消息自带的时间戳生成时间字符串 */
-    struct tm tm_buf;
-    localtime_r(&msg->timestamp, &tm_buf);
-    char time_str[TIMESTAMP_LEN];
-    strftime(time_str, sizeof(time_str), "%Y-%m-%d %H:%M:%S", &tm_buf);
+/* 返回当前线程的局部状态，首次调用时采集线程 ID 与线程名 */
+static log_tls *log_thread_state(void) {
+    log_tls *tls = &t_log;
+    if (tls->tid == 0) {
+#if defined(__linux__)
+        tls->tid = (unsigned long)syscall(SYS_gettid);
+#else
+        tls->tid = (unsigned long)(uintptr_t)pthread_self();
+#endif
+    }
+    if (!tls->name_ready) {
+#if defined(__GLIBC__)
+        if (pthread_getname_np(pthread_self(), tls->name, sizeof(tls->name)) != 0)
+            tls->name[0] = '\0';
+#endif
+        tls->name_ready = 1;
+    }
+    return tls;
+}
+
+/* ======================= 跨进程共享环 ======================= */
+
+#if !defined(_WIN32)
+
+/* 生产者：在共享环中占一个槽并直接格式化，环满时丢弃，不做任何系统调用 */
+static void log_shm_submit(LogLevel level, int is_json, const char *tag, const char *file,
+                           int line, const void *key, const char *fmt, va_list args) {
+    shm_ring *r = g_ctx.shm;
+    uint64_t mask = r->slot_count - 1;
+    uint64_t pos = LOG_ATOMIC_LOAD(&r->enqueue_pos);
+    shm_slot *slot;
+    for (;;) {
+        slot = &r->slots[pos & mask];
+        uint64_t seq = LOG_ATOMIC_LOAD(&slot->seq);
+        int64_t diff = (int64_t)(seq - pos);
+        if (diff == 0) {
+            if (LOG_ATOMIC_CAS(&r->enqueue_pos, &pos, pos + 1)) break;
+        } else if (diff < 0) {
+            LOG_ATOMIC_ADD(&r->dropped, 1);   // 环已满
+            return;
+        } else {
+            pos = LOG_ATOMIC_LOAD(&r->enqueue_pos);
+        }
+    }
+    /* 先登记占用者再格式化：格式化中崩溃时收集者据此跳过该槽 */
+    LOG_ATOMIC_STORE(&slot->owner, g_ctx.pid);
+
+    log_tls *tls = log_thread_state();
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    slot->level = level;
+    slot->is_json = is_json;
+    slot->timestamp = (int64_t)ts.tv_sec;
+    slot->usec = (int32_t)(ts.tv_nsec / 1000);
+    slot->pid = g_ctx.pid;
+    slot->tid = tls->tid;
+    slot->line = line;
+    slot->fmt_key = (uint64_t)(uintptr_t)key;
+    memcpy(slot->thread_name, tls->name, sizeof(slot->thread_name));
+    slot->tag[0] = '\0';
+    if (tag) {
+        strncpy(slot->tag, tag, sizeof(slot->tag) - 1);
+        slot->tag[sizeof(slot->tag) - 1] = '\0';
+    }
+
+    /* 数据区：上下文快照 | 源文件名 | 正文 */
+    char *d = slot->data;
+    size_t room = sizeof(slot->data);
+    size_t clen = tls->ctx_len < room / 2 ? tls->ctx_len : 0;
+    memcpy(d, tls->ctx, clen);
+    slot->ctx_len = (uint16_t)clen;
+    d += clen;
+    room -= clen;
+    slot->file_len = 0;
+    if (file) {
+        const char *base = strrchr(file, '/');
+        base = base ? base + 1 : file;
+        size_t flen = strlen(base) + 1;
+        if (flen < room / 2) {
+            memcpy(d, base, flen);
+            slot->file_len = (uint16_t)flen;
+            d += flen;
+            room -= flen;
+        }
+    }
+    vsnprintf_impl(d, room, fmt, args);
+
+    LOG_ATOMIC_STORE(&slot->seq, pos + 1);   // 发布
+}
+
+/* 将槽内容解释为一条消息，字符串字段直接指向槽内（仅使用 memcpy，可在信号处理中调用） */
+static void log_shm_slot_msg(shm_slot *slot, log_msg *msg) {
+    memset(msg, 0, sizeof(*msg));
+    msg->level = (LogLevel)slot->level;
+    msg->is_json = slot->is_json;
+    msg->timestamp = (time_t)slot->timestamp;
+    msg->usec = slot->usec;
+    msg->pid = slot->pid;
+    msg->tid = (unsigned long)slot->tid;
+    msg->line = slot->line;
+    msg->fmt_key = slot->fmt_key;
+    memcpy(msg->thread_name, slot->thread_name, sizeof(msg->thread_name));
+    msg->thread_name[sizeof(msg->thread_name) - 1] = '\0';
+    memcpy(msg->tag, slot->tag, sizeof(msg->tag));
+    msg->tag[sizeof(msg->tag) - 1] = '\0';
+    /* 长度来自共享内存，不可信：限制在数据区内 */
+    size_t cap = sizeof(slot->data) - 1;
+    size_t clen = slot->ctx_len <= cap ? slot->ctx_len : 0;
+    size_t flen = slot->file_len <= cap - clen ? slot->file_len : 0;
+    slot->data[cap] = '\0';
+    if (flen) slot->data[clen + flen - 1] = '\0';
+    msg->ctx = slot->data;
+    msg->ctx_len = clen;
+    msg->file = flen ? slot->data + clen : NULL;
+    msg->text = slot->data + clen + flen;
+}
+
+static long long log_monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* 位置 pos 的槽已被占用却迟迟未发布时，判断占用者是否已退出（写线程调用）。
+ * 占用者仍存活（例如被暂停）时继续等待，不能跳过，否则它稍后发布会破坏下一圈的槽。 */
+static int log_shm_slot_abandoned(shm_ring *r, shm_slot *slot, uint64_t pos) {
+    if (LOG_ATOMIC_LOAD(&slot->seq) != pos || LOG_ATOMIC_LOAD(&r->enqueue_pos) <= pos) {
+        g_ctx.shm_stall_pos = 0;              // 尚无生产者占用该槽
+        return 0;
+    }
+    long long now = log_monotonic_ms();
+    if (g_ctx.shm_stall_pos != pos + 1) {
+        g_ctx.shm_stall_pos = pos + 1;
+        g_ctx.shm_stall_since = now;
+        return 0;
+    }
+    long long stalled = now - g_ctx.shm_stall_since;
+    int owner = LOG_ATOMIC_LOAD(&slot->owner);
+    if (owner > 0)
+        return stalled >= SHM_STALL_CHECK_MS && kill(owner, 0) != 0 && errno == ESRCH;
+    return stalled >= SHM_STALL_MS;           // 占用后未及登记即退出
+}
+
+/* 以一条 WARN 报告收集者自身发现的问题 */
+static void log_shm_warn(const char *text) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    log_msg msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.level = LOG_LEVEL_WARN;
+    msg.timestamp = ts.tv_sec;
+    msg.usec = ts.tv_nsec / 1000;
+    msg.pid = g_ctx.pid;
+    msg.text = (char*)text;
+    log_write_to_outputs(&msg);
+}
+
+/* 收集者：取出已发布的记录并写入本进程的输出，返回处理条数（写线程调用，不持有锁） */
+static int log_shm_drain(void) {
+    shm_ring *r = g_ctx.shm;
+    shm_slot *copy = g_ctx.shm_scratch;
+    uint64_t pos = r->dequeue_pos;
+    int n = 0;
+    for (; n < MAX_QUEUE_SIZE; n++) {
+        shm_slot *slot = &r->slots[pos & (r->slot_count - 1)];
+        int abandoned = 0;
+        if (LOG_ATOMIC_LOAD(&slot->seq) != pos + 1) {
+            if (!log_shm_slot_abandoned(r, slot, pos))
+                break;
+            abandoned = 1;
+        }
+        /* 以 CAS 认领该位置：崩溃处理同样以 CAS 认领，同一条记录不会写出两次 */
+        uint64_t expected = pos;
+        LOG_ATOMIC_STORE(&g_ctx.inflight, 1);
+        if (!LOG_ATOMIC_CAS(&r->dequeue_pos, &expected, pos + 1)) {
+            LOG_ATOMIC_STORE(&g_ctx.inflight, 0);
+            break;
+        }
+        if (abandoned) {
+            LOG_ATOMIC_STORE(&g_ctx.inflight, 0);
+            /* 占用者已退出：跳过该槽，否则后续记录永远无法取出 */
+            g_ctx.shm_stall_pos = 0;
+            g_ctx.shm_skipped++;
+            LOG_ATOMIC_STORE(&slot->owner, 0);
+            LOG_ATOMIC_STORE(&slot->seq, pos + r->slot_count);
+            pos++;
+            continue;
+        }
+        /* 先复制再释放槽，写文件期间不占用共享环 */
+        memcpy(copy, slot, sizeof(*copy));
+        LOG_ATOMIC_STORE(&slot->owner, 0);
+        LOG_ATOMIC_STORE(&slot->seq, pos + r->slot_count);
+        pos++;
+
+        log_msg msg;
+        log_shm_slot_msg(copy, &msg);
+        log_write_to_outputs(&msg);
+        LOG_ATOMIC_STORE(&g_ctx.inflight, 0);
+    }
+
+    /* 环满丢弃与跳过的记录各以一条 WARN 报告 */
+    char text[96];
+    uint64_t dropped = LOG_ATOMIC_LOAD(&r->dropped);
+    if (dropped != g_ctx.shm_dropped_seen) {
+        snprintf_impl(text, sizeof(text), "[logio] 共享环已满，丢弃 %llu 条记录",
+                      (unsigned long long)(dropped - g_ctx.shm_dropped_seen));
+        g_ctx.shm_dropped_seen = dropped;
+        log_shm_warn(text);
+    }
+    if (g_ctx.shm_skipped) {
+        snprintf_impl(text, sizeof(text), "[logio] 跳过 %llu 条未完成的共享环记录（生产者已退出）",
+                      (unsigned long long)g_ctx.shm_skipped);
+        g_ctx.shm_skipped = 0;
+        log_shm_warn(text);
+    }
+    return n;
+}
+
+/* 等待共享环中当前已提交的记录被收集者取走（收集者退出时放弃等待） */
+static void log_shm_wait_drained(void) {
+    shm_ring *r = g_ctx.shm;
+    uint64_t target = LOG_ATOMIC_LOAD(&r->enqueue_pos);
+    struct timespec pause = { 0, 1000000 };
+    while (LOG_ATOMIC_LOAD(&r->dequeue_pos) < target) {
+        if (r->collector_pid != g_ctx.pid && kill(r->collector_pid, 0) != 0 && errno == ESRCH)
+            break;
+        nanosleep(&pause, NULL);
+    }
+}
+
+static void log_shm_unmap(void) {
+    if (!g_ctx.shm) return;
+    if (g_ctx.shm_role == LOG_SHM_COLLECTOR && g_ctx.shm_path)
+        unlink(g_ctx.shm_path);
+    munmap(g_ctx.shm, g_ctx.shm_size);
+    g_ctx.shm = NULL;
+    g_ctx.shm_role = LOG_SHM_NONE;
+}
+
+#else
+
+static void log_shm_submit(LogLevel level, int is_json, const char *tag, const char *file,
+                           int line, const void *key, const char *fmt, va_list args) {
+    (void)level; (void)is_json; (void)tag; (void)file; (void)line; (void)key; (void)fmt; (void)args;
+}
+static int  log_shm_drain(void) { return 0; }
+static void log_shm_wait_drained(void) {}
+static void log_shm_unmap(void) {}
+
+#endif /* !_WIN32 */
+
+/* 带超时的条件等待（需持有锁） */
+static void log_cond_timedwait_ms(int ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+    pthread_cond_timedwait(&g_ctx.cond, &g_ctx.mutex, &deadline);
+}
+
+/* ======================= 时间索引 ======================= */
+
+/* 为当前主文件打开 <path>.idx，新文件先写入文件头（需持有锁） */
+static void log_index_open(void) {
+    if (!g_ctx.index_enabled || !g_ctx.current_file_path) return;
+    size_t len = strlen(g_ctx.current_file_path) + 5;
+    char *path = (char*)malloc(len);
+    if (!path) return;
+    snprintf_impl(path, len, "%s.idx", g_ctx.current_file_path);
+    FILE *fp = fopen(path, "ab");
+    if (!fp) {
+        fprintf(stderr, "[logio] 无法打开索引文件: %s (%s)\n", path, strerror(errno));
+        free(path);
+        return;
+    }
+    free(path);
+    if (ftell(fp) == 0) {
+        char header[LOG_INDEX_HEADER_LEN];
+        memset(header, 0, sizeof(header));
+        memcpy(header, LOG_INDEX_MAGIC, sizeof(LOG_INDEX_MAGIC) - 1);
+        fwrite(header, 1, sizeof(header), fp);
+        fflush(fp);
+    }
+    g_ctx.index_file = fp;
+    g_ctx.index_last_ts = 0;
+    g_ctx.index_pending = g_ctx.index_gran;   // 第一条记录总是建立索引项
+}
+
+static void log_index_close(void) {
+    if (g_ctx.index_file) {
+        fclose(g_ctx.index_file);
+        g_ctx.index_file = NULL;
+    }
+}
+
+/* 主文件即将写入一条记录：进入新的一秒且距上个索引项足够远时，记录其起始偏移。
+ * 偏移取自 fstat，fork 后多个进程追加同一文件时仍然准确 */
+static void log_index_note(FILE *fp, time_t ts, size_t len) {
+    if (ts > g_ctx.index_last_ts && g_ctx.index_pending >= g_ctx.index_gran) {
+        struct stat_impl st;
+        if (fstat_impl(fileno_impl(fp), &st) == 0) {
+            LogIndexEntry e;
+            e.timestamp = (int64_t)ts;
+            e.offset = (int64_t)st.st_size;
+            fwrite(&e, sizeof(e), 1, g_ctx.index_file);
+            fflush(g_ctx.index_file);
+            g_ctx.index_last_ts = ts;
+            g_ctx.index_pending = 0;
+        }
+    }
+    g_ctx.index_pending += (long)len;
+}
+
+/* 滚动时索引随日志文件一起改名 */
+static void log_index_rename(const char *old_path, const char *new_path) {
+    size_t olen = strlen(old_path) + 5;
+    size_t nlen = strlen(new_path) + 5;
+    char *old_idx = (char*)malloc(olen);
+    char *new_idx = (char*)malloc(nlen);
+    if (old_idx && new_idx) {
+        snprintf_impl(old_idx, olen, "%s.idx", old_path);
+        snprintf_impl(new_idx, nlen, "%s.idx", new_path);
+        rename(old_idx, new_idx);
+    }
+    free(old_idx);
+    free(new_idx);
+}
+
+/* ======================= 尾随环 ======================= */
+
+/* 发布一条已渲染的记录；读者通过 seq 检测覆盖，写线程从不等待读者 */
+static void log_tail_publish(LogLevel level, const char *line, size_t len) {
+    uint64_t n = g_ctx.tail_head;
+    tail_slot *slot = &g_ctx.tail[n & (g_ctx.tail_cap - 1)];
+    if (len > 0 && line[len - 1] == '\n') len--;
+    if (len > TAIL_SLOT_LEN) len = TAIL_SLOT_LEN;
+
+    __atomic_store_n(&slot->seq, 2 * n + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    slot->level = level;
+    slot->len = (uint32_t)len;
+    memcpy(slot->line, line, len);
+    LOG_ATOMIC_STORE(&slot->seq, 2 * n + 2);
+    LOG_ATOMIC_STORE(&g_ctx.tail_head, n + 1);
+}
+
+/* ======================= 后台写线程 ======================= */
 
-    const char *level_str[] = { "DEBUG", "INFO", "WARN", "ERROR" };
-    const char *level_name = (msg->level >= 0 && msg->level <= 3) ?
-                              level_str[msg->level] : "UNKNOWN";
+/* 写出一条消息到所有输出（需持有锁） */
+static void log_emit_locked(log_msg *msg) {
+    /* 每个布局对本条消息只渲染一次，共享该布局的输出复用同一缓冲 */
+    int rendered[MAX_LAYOUTS];
+    for (int i = 0; i < g_ctx.layout_count; i++) rendered[i] = -1;
+    int kind = msg->is_json ? 1 : 0;
 
     for (int i = 0; i < g_ctx.output_count; i++) {
         log_output *out = &g_ctx.outputs[i];
         if (out->type == LOG_OUTPUT_FILE && out->target.file == NULL)
             continue;  // 文件未打开
+        if (!log_output_accepts(out, msg))
+            continue;  // 被过滤的消息不渲染
+
+        if (out->type == LOG_OUTPUT_CALLBACK) {
+            /* 回调接收原始消息正文 */
+            g_ctx.in_callback = 1;
+            out->target.callback.cb(msg->level, msg->text, msg->timestamp, msg->is_json,
+                                    out->target.callback.userdata);
+            g_ctx.in_callback = 0;
+            continue;
+        }
 
-        if (msg->is_json) {
-            /* JSON 输出：{"level":"...","time":"...","msg":"..."} */
-            char *escaped = json_escape(msg->text);
-            if (!escaped) continue;
-            char buf[4096];
-            int len = snprintf_impl(buf, sizeof(buf),
-                                    "{\"level\":\"%s\",\"time\":\"%s\",\"msg\":\"%s\"}\n",
-                                    level_name, time_str, escaped);
-            free(escaped);
-            if (len < 0) continue;
-
-            if (out->type == LOG_OUTPUT_FILE) {
-                fwrite(buf, 1, len, out->target.file);
-                fflush(out->target.file);
-            } else if (out->type == LOG_OUTPUT_STREAM) {
-                /* JSON 不加颜色 */
-                fwrite(buf, 1, len, out->target.file);
-                fflush(out->target.file);
-            } else if (out->type == LOG_OUTPUT_CALLBACK) {
-                /* 回调传递原始 msg 或完整行？这里传原始 */
-                out->target.callback.cb(msg->level, msg->text, msg->timestamp, 1,
-                                        out->target.callback.userdata);
+        int li = out->layout[kind];
+        log_layout *lay = &g_ctx.layouts[li];
+        if (rendered[li] < 0)
+            rendered[li] = (int)layout_render(lay, msg, lay->line, LINE_BUF_LEN, 0);
+        size_t len = (size_t)rendered[li];
+
+        if (out->type == LOG_OUTPUT_STREAM && !msg->is_json &&
+            out->color_enabled && out->is_tty) {
+            /* 添加 ANSI 颜色（JSON 不加颜色） */
+            const char *color = "";
+            switch (msg->level) {
+                case LOG_LEVEL_DEBUG: color = "\x1b[36m"; break; /* cyan */
+                case LOG_LEVEL_INFO:  color = "\x1b[0m"; break;  /* reset */
+                case LOG_LEVEL_WARN:  color = "\x1b[33m"; break; /* yellow */
+                case LOG_LEVEL_ERROR: color = "\x1b[31m"; break; /* red */
+                default: break;
             }
+            fputs(color, out->target.file);
+            fwrite(lay->line, 1, len, out->target.file);
+            fputs("\x1b[0m", out->target.file);
         } else {
-            /* 普通文本输出：[LEVEL/TIME] text */
-            char line[4096];
-            int len = snprintf_impl(line, sizeof(line), "[%s/%s] %s\n",
-                                    level_name, time_str, msg->text);
-            if (len < 0) continue;
-
-            if (out->type == LOG_OUTPUT_FILE) {
-                fwrite(line, 1, len, out->target.file);
-                fflush(out->target.file);
-            } else if (out->type == LOG_OUTPUT_STREAM) {
-                if (out->color_enabled && out->is_tty) {
-                    /* 添加 ANSI 颜色 */
-                    const char *color = "";
-                    switch (msg->level) {
-                        case LOG_LEVEL_DEBUG: color = "\x1b[36m"; break; /* cyan */
-                        case LOG_LEVEL_INFO:  color = "\x1b[0m"; break;  /* reset */
-                        case LOG_LEVEL_WARN:  color = "\x1b[33m"; break; /* yellow */
-                        case LOG_LEVEL_ERROR: color = "\x1b[31m"; break; /* red */
-                        default: break;
-                    }
-                    fprintf(out->target.file, "%s%s\x1b[0m", color, line);
-                } else {
-                    fwrite(line, 1, len, out->target.file);
-                }
-                fflush(out->target.file);
-            } else if (out->type == LOG_OUTPUT_CALLBACK) {
-                out->target.callback.cb(msg->level, msg->text, msg->timestamp, 0,
-                                        out->target.callback.userdata);
-            }
+            if (out->id == 0 && g_ctx.index_file)
+                log_index_note(out->target.file, msg->timestamp, len);
+            fwrite(lay->line, 1, len, out->target.file);
         }
+        fflush(out->target.file);
+    }
+
+    /* 尾随环保存默认布局渲染的行 */
+    if (g_ctx.tail) {
+        int li = msg->is_json ? LAYOUT_DEFAULT_JSON : LAYOUT_DEFAULT_TEXT;
+        log_layout *lay = &g_ctx.layouts[li];
+        if (rendered[li] < 0)
+            rendered[li] = (int)layout_render(lay, msg, lay->line, LINE_BUF_LEN, 0);
+        log_tail_publish(msg->level, lay->line, (size_t)rendered[li]);
     }
 
     /* 写入后检查是否需要滚动（仅对文件输出） */
     log_check_roll();
+}
+
+/* ======================= 重复消息合并 ======================= */
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/* 记录指纹：级别、类型、进程与标签相同，且正文（或格式串）相同才视为重复。
+ * 格式串地址只在同一进程内有意义，进程 ID 参与指纹，共享环中不同生产者不会误合并。 */
+static uint64_t log_dedup_hash(const log_msg *msg) {
+    uint64_t h = 14695981039346656037ULL;
+    int head[3] = { (int)msg->level, msg->is_json, msg->pid };
+    h = fnv1a(h, head, sizeof(head));
+    h = fnv1a(h, msg->tag, strlen(msg->tag));
+    if (g_ctx.dedup_mode == LOG_DEDUP_FORMAT && msg->fmt_key)
+        return fnv1a(h, &msg->fmt_key, sizeof(msg->fmt_key));
+    h = fnv1a(h, msg->ctx, msg->ctx_len);
+    return fnv1a(h, msg->text, strlen(msg->text));
+}
+
+static long long log_msg_ms(const log_msg *msg) {
+    return (long long)msg->timestamp * 1000 + msg->usec / 1000;
+}
+
+/* 写出"重复 N 次"汇总并结束本轮（需持有锁） */
+static void log_dedup_flush_locked(void) {
+    if (g_ctx.dedup_count == 0) return;
+    char text[96];
+    snprintf_impl(text, sizeof(text),
+                  g_ctx.dedup_mode == LOG_DEDUP_FORMAT ?
+                  "[logio] 上一条消息（同格式）重复 %lu 次" : "[logio] 上一条消息重复 %lu 次",
+                  g_ctx.dedup_count);
+    log_msg msg = g_ctx.dedup_last;
+    msg.text = text;
+    msg.ctx = NULL;
+    msg.ctx_len = 0;
+    msg.fmt_key = 0;
+    msg.file = NULL;          // 共享环记录的 file 指向已复用的槽缓冲
+    msg.line = 0;
+    g_ctx.dedup_count = 0;
+    g_ctx.dedup_hash = 0;
+    log_emit_locked(&msg);
+}
+
+/* 距离待写汇总到期的毫秒数，0 表示已到期，-1 表示没有待写汇总（需持有锁） */
+static long log_dedup_due_ms(void) {
+    if (g_ctx.dedup_count == 0) return -1;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    long long now = (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+    long long left = g_ctx.dedup_start_ms + g_ctx.dedup_window_ms - now;
+    return left > 0 ? (long)left : 0;
+}
 
+/* 判断消息是否与上一条重复；是则计数并返回 1，调用方不再写出（需持有锁） */
+static int log_dedup_absorb(log_msg *msg) {
+    uint64_t h = log_dedup_hash(msg);
+    long long now = log_msg_ms(msg);
+    if (h == g_ctx.dedup_hash && now - g_ctx.dedup_start_ms < g_ctx.dedup_window_ms) {
+        g_ctx.dedup_count++;
+        g_ctx.dedup_last = *msg;
+        return 1;
+    }
+    /* 新的一轮：先补写上一轮的汇总 */
+    log_dedup_flush_locked();
+    g_ctx.dedup_hash = h;
+    g_ctx.dedup_start_ms = now;
+    return 0;
+}
+
+static int log_write_to_outputs(log_msg *msg) {
+    /* 遍历 outputs 时需要持有锁，避免输出列表被修改 */
+    LOG_MUTEX_LOCK(&g_ctx.mutex);
+    if (g_ctx.dedup_mode == LOG_DEDUP_OFF || !log_dedup_absorb(msg))
+        log_emit_locked(msg);
     LOG_MUTEX_UNLOCK(&g_ctx.mutex);
-    free(msg->text);
-    free(msg);
     return 0;
 }
 
-static void log_check_roll(void) {
-    if (g_ctx.roll_mode == LOG_ROLL_NONE) return;
-    log_output *file_out = NULL;
-    /* 查找主文件输出（id == 0） */
+/* 在写线程中渲染延迟记录的正文后写出；缓冲分配失败时写出占位正文 */
+static void log_write_deferred(log_msg *msg) {
+    char *block = msg->text;
+    if (!g_ctx.render_buf)
+        g_ctx.render_buf = (char*)malloc(LINE_BUF_LEN);
+    if (g_ctx.render_buf) {
+        size_t n = msg->render(msg->payload, msg->payload_len, g_ctx.render_buf, LINE_BUF_LEN);
+        g_ctx.render_buf[n < LINE_BUF_LEN ? n : LINE_BUF_LEN - 1] = '\0';
+        msg->text = g_ctx.render_buf;
+    }
+    log_write_to_outputs(msg);
+    msg->text = block;
+}
+
+/* 查找主文件输出（id == 0），不存在返回 NULL（需持有锁） */
+static log_output *log_main_file_output(void) {
     for (int i = 0; i < g_ctx.output_count; i++) {
-        if (g_ctx.outputs[i].type == LOG_OUTPUT_FILE && g_ctx.outputs[i].id == 0) {
-            file_out = &g_ctx.outputs[i];
-            break;
+        if (g_ctx.outputs[i].type == LOG_OUTPUT_FILE && g_ctx.outputs[i].id == 0)
+            return &g_ctx.outputs[i];
+    }
+    return NULL;
+}
+
+/* 按 dir_part / fmt_part 生成新文件名并打开为主文件输出，失败时临时改用 stderr */
+static void log_open_main_file(log_output *file_out) {
+    time_t now = time(NULL);
+    char *new_filename = parse_filefmt(g_ctx.fmt_part, now);
+    if (!new_filename) {
+        file_out->target.file = stderr;
+        g_ctx.file_fd = 2;
+        free(g_ctx.current_file_path);
+        g_ctx.current_file_path = NULL;
+        return;
+    }
+    size_t dlen = strlen(g_ctx.dir_part);
+    size_t nlen = strlen(new_filename);
+    char *full_path = (char*)malloc(dlen + 1 + nlen + 1);
+    if (full_path) {
+        snprintf_impl(full_path, dlen + nlen + 2, "%s/%s", g_ctx.dir_part, new_filename);
+        FILE *new_file = fopen(full_path, "a");
+        if (new_file) {
+            file_out->target.file = new_file;
+            g_ctx.file_fd = fileno_impl(new_file);
+            free(g_ctx.current_file_path);
+            g_ctx.current_file_path = full_path;
+        } else {
+            file_out->target.file = stderr;
+            g_ctx.file_fd = 2;
+            free(full_path);
         }
+    } else {
+        file_out->target.file = stderr;
+        g_ctx.file_fd = 2;
     }
+    free(new_filename);
+    if (file_out->target.file != stderr)
+        log_index_open();
+}
+
+/* 继承模式的子进程与父进程共用同一文件，滚动只由父进程执行。
+ * 子进程在到达滚动条件后（每秒至多一次）比较路径与已打开文件的 inode，
+ * 发现父进程已轮转时按路径重新打开 */
+static void log_follow_roll(log_output *file_out) {
+    struct stat_impl cur, st;
+    if (fstat_impl(fileno_impl(file_out->target.file), &cur) != 0) return;
+    time_t now = time(NULL);
+    if (g_ctx.roll_mode == LOG_ROLL_SIZE ? cur.st_size < g_ctx.roll_max_size
+                                         : now < g_ctx.next_roll_time)
+        return;
+    if (now < g_ctx.follow_check_ts) return;
+    g_ctx.follow_check_ts = now + 1;
+    if (!g_ctx.current_file_path ||
+        (stat_impl(g_ctx.current_file_path, &st) == 0 &&
+         st.st_ino == cur.st_ino && st.st_dev == cur.st_dev))
+        return;                     // 父进程尚未轮转
+
+    g_ctx.file_fd = -1;
+    fclose(file_out->target.file);
+    log_open_main_file(file_out);
+    if (g_ctx.roll_mode == LOG_ROLL_TIME)
+        g_ctx.next_roll_time = now + g_ctx.roll_interval;
+}
+
+static void log_check_roll(void) {
+    if (g_ctx.roll_mode == LOG_ROLL_NONE) return;
+    log_output *file_out = log_main_file_output();
     if (!file_out || !file_out->target.file) return;
+    if (g_ctx.roll_follower) {
+        log_follow_roll(file_out);
+        return;
+    }
 
     int need_roll = 0;
     if (g_ctx.roll_mode == LOG_ROLL_SIZE) {
@@ -421,7 +1437,9 @@ static void log_check_roll(void) {
         /* 关闭旧文件 */
         FILE *old_file = file_out->target.file;
         char *old_path = g_ctx.current_file_path;
+        g_ctx.file_fd = -1;
         fclose(old_file);
+        log_index_close();
 
         /* 重命名旧文件，加上时间戳后缀避免覆盖 */
         if (old_path) {
@@ -432,49 +1450,70 @@ static void log_check_roll(void) {
             char ts_suffix[32];
             strftime(ts_suffix, sizeof(ts_suffix), "%Y%m%d_%H%M%S", &tm_buf);
             snprintf_impl(new_name, sizeof(new_name), "%s.%s", old_path, ts_suffix);
+            /* 同一秒内多次滚动时追加序号，避免覆盖已滚动的文件 */
+            struct stat_impl st;
+            for (int seq = 1; stat_impl(new_name, &st) == 0 && seq < 1000; seq++)
+                snprintf_impl(new_name, sizeof(new_name), "%s.%s.%d", old_path, ts_suffix, seq);
             rename(old_path, new_name);
+            log_index_rename(old_path, new_name);
         }
 
         /* 生成新文件名并打开 */
-        time_t now = time(NULL);
-        char *new_filename = parse_filefmt(g_ctx.fmt_part, now);
-        if (!new_filename) {
-            /* 失败则输出到 stderr 临时替代 */
-            file_out->target.file = stderr;
-            free(g_ctx.current_file_path);
-            g_ctx.current_file_path = NULL;
-            return;
-        }
-        size_t dlen = strlen(g_ctx.dir_part);
-        size_t nlen = strlen(new_filename);
-        char *full_path = (char*)malloc(dlen + 1 + nlen + 1);
-        if (full_path) {
-            snprintf_impl(full_path, dlen + nlen + 2, "%s/%s", g_ctx.dir_part, new_filename);
-            FILE *new_file = fopen(full_path, "a");
-            if (new_file) {
-                file_out->target.file = new_file;
-                free(g_ctx.current_file_path);
-                g_ctx.current_file_path = full_path;
-            } else {
-                file_out->target.file = stderr;
-                free(full_path);
-            }
-        } else {
-            file_out->target.file = stderr;
-        }
-        free(new_filename);
+        log_open_main_file(file_out);
     }
 }
 
 static void *log_worker(void *arg) {
     (void)arg;
+    int local_run = 0;   // 自上次取共享环以来连续写出的本进程记录数
     LOG_MUTEX_LOCK(&g_ctx.mutex);
-    while (!g_ctx.quit) {
-        log_msg *msg = log_dequeue_msg();
-        if (msg == NULL) break;  // quit && queue empty
-        LOG_MUTEX_UNLOCK(&g_ctx.mutex);  // 写入时不持有锁，提高并发
-        log_write_to_outputs(msg);
-        LOG_MUTEX_LOCK(&g_ctx.mutex);
+    for (;;) {
+        /* 收集者交替处理两个来源，本进程持续写日志时共享环也能及时取出 */
+        log_msg *msg = NULL;
+        if (g_ctx.shm_role != LOG_SHM_COLLECTOR || local_run < SHM_LOCAL_BURST)
+            msg = log_dequeue_msg();
+        if (msg) {
+            local_run++;
+            g_ctx.writing = 1;
+            LOG_ATOMIC_STORE(&g_ctx.inflight, 1);
+            LOG_MUTEX_UNLOCK(&g_ctx.mutex);  // 写入时不持有锁，提高并发
+            if (msg->render)
+                log_write_deferred(msg);
+            else
+                log_write_to_outputs(msg);
+            log_msg_free(msg);
+            LOG_ATOMIC_STORE(&g_ctx.inflight, 0);   // 不加锁清除：崩溃线程可能持有锁
+            LOG_MUTEX_LOCK(&g_ctx.mutex);
+            g_ctx.writing = 0;
+            if (g_ctx.idle_waiters && g_ctx.queue_count == 0)
+                LOG_COND_BROADCAST(&g_ctx.cond);   // LogFlush 只在最后一条写完后返回
+            continue;
+        }
+        if (LOG_ATOMIC_LOAD(&g_ctx.crashing)) {
+            LOG_COND_WAIT(&g_ctx.cond, &g_ctx.mutex);   // 进程即将终止，不再写出
+            continue;
+        }
+        if (g_ctx.shm_role == LOG_SHM_COLLECTOR) {
+            LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+            int drained = log_shm_drain();
+            LOG_MUTEX_LOCK(&g_ctx.mutex);
+            local_run = 0;
+            if (drained > 0 || g_ctx.queue_head) continue;
+        }
+        /* 重复汇总到期或即将退出时写出，空闲时不会无限推迟 */
+        long due = log_dedup_due_ms();
+        if (due == 0 || (due > 0 && g_ctx.quit)) {
+            log_dedup_flush_locked();
+            continue;
+        }
+        if (g_ctx.quit) break;  // 队列与共享环均已清空
+        /* 共享环的生产者不会唤醒本线程，收集者需定时轮询 */
+        if (g_ctx.shm_role == LOG_SHM_COLLECTOR)
+            log_cond_timedwait_ms(due > 0 && due < SHM_POLL_MS ? (int)due : SHM_POLL_MS);
+        else if (due > 0)
+            log_cond_timedwait_ms((int)due);
+        else
+            LOG_COND_WAIT(&g_ctx.cond, &g_ctx.mutex);
     }
     LOG_MUTEX_UNLOCK(&g_ctx.mutex);
     return NULL;
@@ -482,6 +1521,9 @@ static void *log_worker(void *arg) {
 
 /* ======================= 清理函数（atexit 注册） ======================= */
 static void log_cleanup(void) {
+    /* InitLog 重复调用会多次注册本函数，已清理过则直接返回 */
+    if (!g_ctx.initialized) return;
+
     /* 通知后台线程退出 */
     LOG_MUTEX_LOCK(&g_ctx.mutex);
     g_ctx.quit = 1;
@@ -489,7 +1531,10 @@ static void log_cleanup(void) {
     LOG_MUTEX_UNLOCK(&g_ctx.mutex);
 
     /* 等待线程结束 */
-    LOG_THREAD_JOIN(g_ctx.thread);
+    if (g_ctx.thread_started) {
+        LOG_THREAD_JOIN(g_ctx.thread);
+        g_ctx.thread_started = 0;
+    }
 
     /* 清理输出目标 */
     for (int i = 0; i < g_ctx.output_count; i++) {
@@ -499,14 +1544,260 @@ static void log_cleanup(void) {
         }
     }
 
+    log_index_close();
     free(g_ctx.dir_part);
     free(g_ctx.fmt_part);
     free(g_ctx.current_file_path);
 
+    for (int i = 0; i < g_ctx.layout_count; i++) {
+        free(g_ctx.layouts[i].pattern);
+        free(g_ctx.layouts[i].line);
+    }
+
+    log_shm_unmap();
+    free(g_ctx.shm_path);
+    free(g_ctx.shm_scratch);
+    free(g_ctx.tail);
+    free(g_ctx.render_buf);
+
     LOG_MUTEX_DESTROY(&g_ctx.mutex);
     LOG_COND_DESTROY(&g_ctx.cond);
+    g_ctx.initialized = 0;
+}
+
+/* ======================= fork 处理（pthread_atfork 注册） ======================= */
+
+#if !defined(_WIN32)
+
+/* 在输出回调中调用 fork：写线程已持有锁，本次 fork 不再加锁、不等待队列写空 */
+static int g_fork_in_callback;
+
+/* fork 前：等待队列写空并刷新输出，然后持有锁跨过 fork，子进程不会继承半写状态 */
+static void log_atfork_prepare(void) {
+    if (!g_ctx.initialized) return;
+    g_fork_in_callback = g_ctx.thread_started &&
+                         pthread_equal(pthread_self(), g_ctx.thread) && g_ctx.in_callback;
+    if (g_fork_in_callback) return;
+    LOG_MUTEX_LOCK(&g_ctx.mutex);
+    if (g_ctx.thread_started && !pthread_equal(pthread_self(), g_ctx.thread))
+        log_wait_idle();
+    for (int i = 0; i < g_ctx.output_count; i++) {
+        log_output *out = &g_ctx.outputs[i];
+        if (out->type != LOG_OUTPUT_CALLBACK && out->target.file)
+            fflush(out->target.file);
+    }
+    if (g_ctx.index_file)
+        fflush(g_ctx.index_file);
 }
 
+static void log_atfork_parent(void) {
+    if (!g_ctx.initialized || g_fork_in_callback) return;
+    LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+}
+
+/* fork 后的子进程：只重置锁与标志，写线程在第一次使用时重建 */
+static void log_atfork_child(void) {
+    if (!g_ctx.initialized) return;
+    LOG_MUTEX_INIT(&g_ctx.mutex);
+    LOG_COND_INIT(&g_ctx.cond);
+    if (g_fork_in_callback)
+        LOG_MUTEX_LOCK(&g_ctx.mutex);   // 回调返回后由写线程的代码释放
+    g_ctx.in_callback = 0;
+    t_log.tid = 0;                  // 子进程中线程 ID 已改变
+    g_ctx.pid = (int)getpid();
+    g_ctx.quit = 0;
+    g_ctx.writing = 0;              // 写线程没有被复制到子进程
+    g_ctx.idle_waiters = 0;
+    g_ctx.dedup_count = 0;          // 待写的重复汇总属于父进程
+    g_ctx.dedup_hash = 0;
+    if (g_ctx.shm_role == LOG_SHM_PRODUCER)
+        return;                     // 生产者没有写线程，继承即可用
+    g_ctx.thread_started = 0;
+    if (g_ctx.fork_mode == LOG_FORK_DISABLE) {
+        g_ctx.disabled = 1;
+        g_ctx.admit_mask = 0;
+        if (g_ctx.shm_role == LOG_SHM_COLLECTOR) {
+            /* 共享环属于父进程：不再以收集者身份访问，退出时也不删除后备文件 */
+            g_ctx.shm_role = LOG_SHM_NONE;
+            free(g_ctx.shm_path);
+            g_ctx.shm_path = NULL;
+        }
+    } else if (g_ctx.shm_role == LOG_SHM_COLLECTOR) {
+        g_ctx.shm_role = LOG_SHM_PRODUCER;   // 子进程转为共享环生产者
+    } else {
+        /* 继承模式下滚动只由父进程执行；按进程分文件时自行滚动 */
+        g_ctx.roll_follower = (g_ctx.fork_mode == LOG_FORK_INHERIT);
+        g_ctx.follow_check_ts = 0;
+        g_ctx.fork_resume = 1;
+    }
+}
+
+/* 子进程首次使用时：丢弃继承的队列，按 fork 模式重开文件并重建写线程 */
+static void log_resume_after_fork(void) {
+    LOG_MUTEX_LOCK(&g_ctx.mutex);
+    if (!g_ctx.fork_resume) {
+        LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+        return;
+    }
+    g_ctx.fork_resume = 0;
+
+    /* 队列中的消息属于父进程，由父进程写出 */
+    while (g_ctx.queue_head) {
+        log_msg *msg = g_ctx.queue_head;
+        g_ctx.queue_head = msg->next;
+        log_msg_free(msg);
+    }
+    g_ctx.queue_tail = NULL;
+    g_ctx.queue_count = 0;
+
+    /* 共享文件的索引由父进程维护（偏移取自 fstat，已包含子进程写入的内容） */
+    log_index_close();
+    if (g_ctx.roll_follower)
+        g_ctx.index_enabled = 0;
+
+    log_output *file_out = log_main_file_output();
+    if (g_ctx.fork_mode == LOG_FORK_PER_PID && file_out && g_ctx.fmt_part) {
+        /* 文件名格式追加 .<pid>，之后的滚动也沿用 */
+        size_t len = strlen(g_ctx.fmt_part) + 16;
+        char *fmt = (char*)malloc(len);
+        if (fmt) {
+            snprintf_impl(fmt, len, "%s.%d", g_ctx.fmt_part, g_ctx.pid);
+            free(g_ctx.fmt_part);
+            g_ctx.fmt_part = fmt;
+            g_ctx.file_fd = -1;
+            if (file_out->target.file && file_out->target.file != stderr)
+                fclose(file_out->target.file);
+            log_open_main_file(file_out);
+        }
+    }
+
+    if (LOG_THREAD_CREATE(&g_ctx.thread, log_worker, NULL) == 0)
+        g_ctx.thread_started = 1;
+    else {
+        g_ctx.disabled = 1;     // 无写线程时关闭日志，避免队列写满后阻塞
+        g_ctx.admit_mask = 0;
+    }
+    LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+}
+
+/* 注册 fork 处理（仅一次）：InitLog 与 LogShmAttach 打开的生产者都需要 */
+static void log_register_atfork(void) {
+    static int atfork_registered = 0;
+    if (!atfork_registered) {
+        pthread_atfork(log_atfork_prepare, log_atfork_parent, log_atfork_child);
+        atfork_registered = 1;
+    }
+}
+
+#else
+
+static void log_resume_after_fork(void) {}
+static void log_register_atfork(void) {}
+
+#endif /* !_WIN32 */
+
+/* ======================= 崩溃处理（致命信号） ======================= */
+
+#if !defined(_WIN32)
+
+static const int k_crash_signals[] = { SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT };
+#define CRASH_SIGNAL_COUNT  (int)(sizeof(k_crash_signals) / sizeof(k_crash_signals[0]))
+
+static struct sigaction g_crash_old[CRASH_SIGNAL_COUNT];
+static volatile sig_atomic_t g_crash_entered;
+static char g_crash_line[LINE_BUF_LEN];   // 信号处理中使用的渲染缓冲
+
+/* 按主文件输出的布局渲染一条消息并直接 write(2) */
+static void log_crash_write(const log_output *out, int fd, const log_msg *msg) {
+    if (out && !log_output_accepts(out, msg)) return;
+    int li = out ? out->layout[msg->is_json ? 1 : 0] : LAYOUT_DEFAULT_TEXT;
+    size_t len = layout_render(&g_ctx.layouts[li], msg, g_crash_line, sizeof(g_crash_line), 1);
+    const char *p = g_crash_line;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+/* 不加锁、不分配内存地写出队列与共享环中尚未落盘的记录 */
+static void log_crash_flush(int sig) {
+    const log_output *out = NULL;
+    for (int i = 0; i < g_ctx.output_count; i++) {
+        if (g_ctx.outputs[i].type == LOG_OUTPUT_FILE && g_ctx.outputs[i].id == 0)
+            out = &g_ctx.outputs[i];
+    }
+    /* 主文件输出已移除：描述符可能已被复用，不能再写 */
+    if (!out) return;
+    int fd = g_ctx.file_fd;
+    if (fd < 0) fd = 2;             // 正在滚动
+
+    /* 先让写线程停止取出，再整体摘下队列；写线程已取出的记录不在队列中，不会重复写出 */
+    LOG_ATOMIC_STORE(&g_ctx.crashing, 1);
+    const log_msg *head = LOG_ATOMIC_XCHG(&g_ctx.queue_head, NULL);
+
+    /* 等写线程写完已取出的那一条（至多约 100ms），它早于队列中的记录，保持顺序；
+     * 崩溃发生在写线程自身时不等待 */
+    if (!(g_ctx.thread_started && pthread_equal(pthread_self(), g_ctx.thread))) {
+        struct timespec pause = { 0, 1000000 };
+        for (int i = 0; i < 100 && LOG_ATOMIC_LOAD(&g_ctx.inflight); i++)
+            nanosleep(&pause, NULL);
+    }
+    for (const log_msg *msg = head; msg; msg = LOG_ATOMIC_LOAD(&msg->next))
+        log_crash_write(out, fd, msg);
+
+    if (g_ctx.shm_role == LOG_SHM_COLLECTOR) {
+        shm_ring *r = g_ctx.shm;
+        uint64_t pos = LOG_ATOMIC_LOAD(&r->dequeue_pos);
+        for (;;) {
+            shm_slot *slot = &r->slots[pos & (r->slot_count - 1)];
+            if (LOG_ATOMIC_LOAD(&slot->seq) != pos + 1) break;
+            if (!LOG_ATOMIC_CAS(&r->dequeue_pos, &pos, pos + 1))
+                continue;           // 已被写线程取走，pos 已更新为当前位置
+            log_msg msg;
+            log_shm_slot_msg(slot, &msg);
+            log_crash_write(out, fd, &msg);
+            pos++;
+        }
+    }
+
+    /* 最后记录信号本身 */
+    char text[64];
+    char *d = text;
+    char *end = text + sizeof(text) - 1;
+    static const char prefix[] = "[logio] 进程收到致命信号 ";
+    put_bytes(&d, end, prefix, sizeof(prefix) - 1);
+    put_uint(&d, end, (unsigned long)sig, 0);
+    *d = '\0';
+    log_msg msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.level = LOG_LEVEL_ERROR;
+    msg.timestamp = time(NULL);
+    msg.pid = g_ctx.pid;
+    msg.text = text;
+    log_crash_write(NULL, fd, &msg);
+}
+
+static void log_crash_handler(int sig) {
+    if (!g_crash_entered) {
+        g_crash_entered = 1;
+        if (g_ctx.initialized && g_ctx.shm_role != LOG_SHM_PRODUCER)
+            log_crash_flush(sig);
+    }
+    /* 恢复原处理方式并重新投递，保持原有的终止 / core dump 行为 */
+    for (int i = 0; i < CRASH_SIGNAL_COUNT; i++) {
+        if (k_crash_signals[i] == sig)
+            sigaction(sig, &g_crash_old[i], NULL);
+    }
+    raise(sig);
+}
+
+#endif /* !_WIN32 */
+
 /* ======================= 公共 API ======================= */
 
 int InitLog(const char *logFilePath, LogLevel level) {
@@ -522,6 +1813,15 @@ int InitLog(const char *logFilePath, LogLevel level) {
     g_ctx.initialized = 1;
     g_ctx.level = level;
     g_ctx.next_id = 1;    // 0 预留给主文件输出
+    g_ctx.pid = (int)getpid();
+
+    /* 编译默认布局（索引固定为 LAYOUT_DEFAULT_TEXT / LAYOUT_DEFAULT_JSON） */
+    if (layout_intern("[%L/%T] %X%m") != LAYOUT_DEFAULT_TEXT ||
+        layout_intern("{\"level\":\"%L\",\"time\":\"%T\"%J,\"msg\":\"%j\"}") != LAYOUT_DEFAULT_JSON) {
+        fprintf(stderr, "[logio] 内存分配失败\n");
+        log_cleanup();
+        return -1;
+    }
 
     /* 解析路径 */
     const char *dirPart = NULL;
@@ -613,8 +1913,11 @@ int InitLog(const char *logFilePath, LogLevel level) {
     g_ctx.outputs[0].type = LOG_OUTPUT_FILE;
     g_ctx.outputs[0].id = 0;
     g_ctx.outputs[0].target.file = fp;
+    g_ctx.file_fd = fileno_impl(fp);
     g_ctx.outputs[0].color_enabled = 0;
+    log_output_default_layout(&g_ctx.outputs[0]);
     g_ctx.output_count = 1;
+    log_update_admit_mask();
     g_ctx.current_file_path = fullPath;
 
     /* 默认滚动：不滚动 */
@@ -624,62 +1927,188 @@ int InitLog(const char *logFilePath, LogLevel level) {
     /* 启动后台写线程 */
     if (LOG_THREAD_CREATE(&g_ctx.thread, log_worker, NULL) != 0) {
         fprintf(stderr, "[logio] 创建后台线程失败\n");
-        fclose(fp);
-        free(fullPath);
         log_cleanup();
         return -1;
     }
+    g_ctx.thread_started = 1;
 
     /* 注册清理函数（仅一次） */
     atexit(log_cleanup);
+
+    log_register_atfork();
     return 0;
 }
 
-void LogPrintf(LogLevel level, const char *fmt, ...) {
-    if (level < g_ctx.level || !g_ctx.initialized) return;
+/* 组装一条消息：正文、上下文快照与延迟渲染参数放在同一块内存中，上下文只做一次 memcpy */
+static log_msg *log_msg_new(LogLevel level, int is_json, const char *tag, const char *file, int line,
+                            const char *text, size_t tlen, const void *payload, size_t payload_len) {
+    log_msg *msg = (log_msg*)calloc(1, sizeof(log_msg));
+    if (!msg) return NULL;
+
+    log_tls *tls = log_thread_state();
+    msg->text = (char*)malloc(tlen + 1 + tls->ctx_len + payload_len);
+    if (!msg->text) {
+        free(msg);
+        return NULL;
+    }
+    memcpy(msg->text, text, tlen);
+    msg->text[tlen] = '\0';               /* JSON 消息由后台线程转义 */
+    msg->ctx = msg->text + tlen + 1;
+    msg->ctx_len = tls->ctx_len;
+    memcpy(msg->ctx, tls->ctx, tls->ctx_len);
+    if (payload_len > 0) {
+        if (payload)
+            memcpy(msg->ctx + msg->ctx_len, payload, payload_len);
+        msg->payload = msg->ctx + msg->ctx_len;
+        msg->payload_len = payload_len;
+    }
+    memcpy(msg->thread_name, tls->name, sizeof(msg->thread_name));
+    if (tag) {
+        strncpy(msg->tag, tag, sizeof(msg->tag) - 1);
+        msg->tag[sizeof(msg->tag) - 1] = '\0';
+    }
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    msg->level = level;
+    msg->timestamp = ts.tv_sec;
+    msg->usec = ts.tv_nsec / 1000;
+    msg->tid = tls->tid;
+    msg->pid = g_ctx.pid;
+    msg->file = file;
+    msg->line = line;
+    msg->is_json = is_json;
+    return msg;
+}
+
+/* 格式化并投递一条消息 */
+static void log_submit(LogLevel level, int is_json, const char *tag,
+                       const char *file, int line, const char *fmt, va_list args) {
+    if (g_ctx.shm_role == LOG_SHM_PRODUCER) {
+        log_shm_submit(level, is_json, tag, file, line, fmt, fmt, args);
+        return;
+    }
+    if (g_ctx.fork_resume)
+        log_resume_after_fork();
 
-    /* 组装消息 */
     char text[4096];
-    va_list args;
-    va_start(args, fmt);
-    vsnprintf_impl(text, sizeof(text), fmt, args);
-    va_end(args);
+    int n = vsnprintf_impl(text, sizeof(text), fmt, args);
+    if (n < 0) return;
+    size_t tlen = ((size_t)n < sizeof(text)) ? (size_t)n : sizeof(text) - 1;
 
-    log_msg *msg = (log_msg*)calloc(1, sizeof(log_msg));
+    log_msg *msg = log_msg_new(level, is_json, tag, file, line, text, tlen, NULL, 0);
     if (!msg) return;
-    msg->level = level;
-    msg->timestamp = time(NULL);
-    msg->text = strdup(text);
-    msg->is_json = 0;
+    msg->fmt_key = (uint64_t)(uintptr_t)fmt;
 
     LOG_MUTEX_LOCK(&g_ctx.mutex);
     log_enqueue_msg(msg);
     LOG_MUTEX_UNLOCK(&g_ctx.mutex);
 }
 
+/* 以 va_list 形式转交 log_shm_submit */
+static void log_shm_submitf(LogLevel level, const char *file, int line, const void *key,
+                            const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    log_shm_submit(level, 0, NULL, file, line, key, fmt, args);
+    va_end(args);
+}
+
+void LogPrintf(LogLevel level, const char *fmt, ...) {
+    if (!g_ctx.initialized || !log_admits(level)) return;
+    va_list args;
+    va_start(args, fmt);
+    log_submit(level, 0, NULL, NULL, 0, fmt, args);
+    va_end(args);
+}
+
 void LogPrintfJSON(LogLevel level, const char *fmt, ...) {
-    if (level < g_ctx.level || !g_ctx.initialized) return;
+    if (!g_ctx.initialized || !log_admits(level)) return;
+    va_list args;
+    va_start(args, fmt);
+    log_submit(level, 1, NULL, NULL, 0, fmt, args);
+    va_end(args);
+}
 
-    char text[4096];
+void LogPrintfAt(LogLevel level, const char *file, int line, const char *fmt, ...) {
+    if (!g_ctx.initialized || !log_admits(level)) return;
     va_list args;
     va_start(args, fmt);
-    vsnprintf_impl(text, sizeof(text), fmt, args);
+    log_submit(level, 0, NULL, file, line, fmt, args);
     va_end(args);
+}
 
-    log_msg *msg = (log_msg*)calloc(1, sizeof(log_msg));
-    if (!msg) return;
-    msg->level = level;
-    msg->timestamp = time(NULL);
-    msg->text = strdup(text);   /* 后台线程将对其 JSON 转义 */
-    msg->is_json = 1;
+int LogIsEnabled(LogLevel level) {
+    return g_ctx.initialized && log_admits(level);
+}
+
+void LogSubmitDeferred(LogLevel level, const char *file, int line,
+                       LogRenderFn render, const void *payload, size_t len) {
+    if (!g_ctx.initialized || !render || !log_admits(level)) return;
+    if (g_ctx.shm_role == LOG_SHM_PRODUCER) {
+        /* 收集者无法调用本进程的渲染函数，在此渲染后写入共享环 */
+        char text[SHM_SLOT_DATA];
+        size_t n = render(payload, len, text, sizeof(text));
+        text[n < sizeof(text) ? n : sizeof(text) - 1] = '\0';
+        log_shm_submitf(level, file, line, (const void*)render, "%s", text);
+        return;
+    }
+    void *buf = LogReserveDeferred(level, file, line, render, len);
+    if (!buf) return;
+    memcpy(buf, payload, len);
+    LogCommitDeferred(buf);
+}
+
+/* 预留记录的分配：text | ctx | 记录指针 | payload，提交时由 payload 前的指针找回记录 */
+void *LogReserveDeferred(LogLevel level, const char *file, int line,
+                         LogRenderFn render, size_t len) {
+    if (!g_ctx.initialized || !render || !log_admits(level)) return NULL;
+
+    /* 正文在写线程渲染；崩溃时尚未渲染的记录以占位正文写出 */
+    static const char placeholder[] = "[logio] 延迟渲染的记录（未渲染）";
+    log_msg *msg = log_msg_new(level, 0, NULL, file, line,
+                               placeholder, sizeof(placeholder) - 1, NULL, sizeof(msg) + len);
+    if (!msg) return NULL;
+    char *block = (char*)msg->payload;
+    memcpy(block, &msg, sizeof(msg));
+    msg->payload = block + sizeof(msg);
+    msg->payload_len = len;
+    msg->render = render;
+    msg->fmt_key = (uint64_t)(uintptr_t)render;
+    return block + sizeof(msg);
+}
+
+void LogCommitDeferred(void *payload) {
+    if (!payload) return;
+    log_msg *msg;
+    memcpy(&msg, (char*)payload - sizeof(msg), sizeof(msg));
+    if (g_ctx.shm_role == LOG_SHM_PRODUCER) {
+        /* 收集者无法调用本进程的渲染函数，在此渲染后写入共享环 */
+        char text[SHM_SLOT_DATA];
+        size_t n = msg->render(msg->payload, msg->payload_len, text, sizeof(text));
+        text[n < sizeof(text) ? n : sizeof(text) - 1] = '\0';
+        log_shm_submitf(msg->level, msg->file, msg->line, (const void*)msg->render, "%s", text);
+        log_msg_free(msg);
+        return;
+    }
+    if (g_ctx.fork_resume)
+        log_resume_after_fork();
 
     LOG_MUTEX_LOCK(&g_ctx.mutex);
     log_enqueue_msg(msg);
     LOG_MUTEX_UNLOCK(&g_ctx.mutex);
 }
 
+void LogPrintfTag(LogLevel level, const char *tag, const char *fmt, ...) {
+    if (!g_ctx.initialized || !log_admits(level)) return;
+    va_list args;
+    va_start(args, fmt);
+    log_submit(level, 0, tag, NULL, 0, fmt, args);
+    va_end(args);
+}
+
 int LogAddOutputStream(FILE *stream, int enable_color) {
-    if (!g_ctx.initialized) return -1;
+    if (!g_ctx.initialized || g_ctx.shm_role == LOG_SHM_PRODUCER) return -1;
     LOG_MUTEX_LOCK(&g_ctx.mutex);
     if (g_ctx.output_count >= MAX_OUTPUTS) {
         LOG_MUTEX_UNLOCK(&g_ctx.mutex);
@@ -692,12 +2121,14 @@ int LogAddOutputStream(FILE *stream, int enable_color) {
     out->target.file = stream;
     out->color_enabled = enable_color;
     out->is_tty = isatty_impl(fileno_impl(stream));
+    log_output_default_layout(out);
+    log_update_admit_mask();
     LOG_MUTEX_UNLOCK(&g_ctx.mutex);
     return id;
 }
 
 int LogAddCallback(LogCallback cb, void *userdata) {
-    if (!g_ctx.initialized || cb == NULL) return -1;
+    if (!g_ctx.initialized || cb == NULL || g_ctx.shm_role == LOG_SHM_PRODUCER) return -1;
     LOG_MUTEX_LOCK(&g_ctx.mutex);
     if (g_ctx.output_count >= MAX_OUTPUTS) {
         LOG_MUTEX_UNLOCK(&g_ctx.mutex);
@@ -709,6 +2140,8 @@ int LogAddCallback(LogCallback cb, void *userdata) {
     out->id = id;
     out->target.callback.cb = cb;
     out->target.callback.userdata = userdata;
+    log_output_default_layout(out);
+    log_update_admit_mask();
     LOG_MUTEX_UNLOCK(&g_ctx.mutex);
     return id;
 }
@@ -719,6 +2152,11 @@ int LogRemoveOutput(int id) {
     int found = 0;
     for (int i = 0; i < g_ctx.output_count; i++) {
         if (g_ctx.outputs[i].id == id) {
+            if (id == 0) {
+                /* 主文件输出：崩溃处理不再使用其描述符，索引随之关闭 */
+                g_ctx.file_fd = -1;
+                log_index_close();
+            }
             /* 关闭文件（如果是文件且不是 stderr） */
             if (g_ctx.outputs[i].type == LOG_OUTPUT_FILE &&
                 g_ctx.outputs[i].target.file && 
@@ -730,6 +2168,7 @@ int LogRemoveOutput(int id) {
                 g_ctx.outputs[i] = g_ctx.outputs[g_ctx.output_count - 1];
             }
             g_ctx.output_count--;
+            log_update_admit_mask();
             found = 1;
             break;
         }
@@ -738,6 +2177,199 @@ int LogRemoveOutput(int id) {
     return found ? 0 : -1;
 }
 
+int LogContextPush(const char *key, const char *value) {
+    if (!key || !value) return -1;
+    log_tls *tls = &t_log;
+    size_t klen = strlen(key);
+    size_t vlen = strlen(value);
+    if (tls->depth >= MAX_CTX_FIELDS ||
+        tls->ctx_len + klen + vlen + 2 > sizeof(tls->ctx))
+        return -1;
+    char *p = tls->ctx + tls->ctx_len;
+    memcpy(p, key, klen + 1);
+    memcpy(p + klen + 1, value, vlen + 1);
+    tls->ctx_off[tls->depth++] = tls->ctx_len;
+    tls->ctx_len += klen + vlen + 2;
+    return 0;
+}
+
+void LogContextPop(void) {
+    log_tls *tls = &t_log;
+    if (tls->depth == 0) return;
+    tls->ctx_len = tls->ctx_off[--tls->depth];
+}
+
+void LogContextClear(void) {
+    t_log.depth = 0;
+    t_log.ctx_len = 0;
+}
+
+void LogSetThreadName(const char *name) {
+    log_tls *tls = &t_log;
+    if (!name) name = "";
+    size_t len = strlen(name);
+    if (len >= sizeof(tls->name)) len = sizeof(tls->name) - 1;
+    memcpy(tls->name, name, len);
+    tls->name[len] = '\0';
+    tls->name_ready = 1;
+}
+
+int LogSetOutputFilter(int id, unsigned level_mask, const char *tag) {
+    if (!g_ctx.initialized) return -1;
+    if (tag && strlen(tag) >= TAG_LEN) return -1;
+    LOG_MUTEX_LOCK(&g_ctx.mutex);
+    int found = 0;
+    for (int i = 0; i < g_ctx.output_count; i++) {
+        log_output *out = &g_ctx.outputs[i];
+        if (out->id == id) {
+            out->level_mask = level_mask & LOG_LEVEL_MASK_ALL;
+            strcpy(out->tag, tag ? tag : "");
+            log_update_admit_mask();
+            found = 1;
+            break;
+        }
+    }
+    LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+    return found ? 0 : -1;
+}
+
+int LogSetOutputLayout(int id, const char *text_layout, const char *json_layout) {
+    if (!g_ctx.initialized) return -1;
+    LOG_MUTEX_LOCK(&g_ctx.mutex);
+    log_output *out = NULL;
+    for (int i = 0; i < g_ctx.output_count; i++) {
+        if (g_ctx.outputs[i].id == id) {
+            out = &g_ctx.outputs[i];
+            break;
+        }
+    }
+    int text_idx = text_layout ? layout_intern(text_layout) : LAYOUT_DEFAULT_TEXT;
+    int json_idx = json_layout ? layout_intern(json_layout) : LAYOUT_DEFAULT_JSON;
+    if (!out || text_idx < 0 || json_idx < 0) {
+        LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+        return -1;
+    }
+    out->layout[0] = text_idx;
+    out->layout[1] = json_idx;
+    LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+    return 0;
+}
+
+#if !defined(_WIN32)
+
+int LogShmCreate(const char *path, size_t slots) {
+    if (!g_ctx.initialized || g_ctx.shm_role != LOG_SHM_NONE) return -1;
+    size_t count = 1;
+    if (slots == 0) slots = SHM_DEFAULT_SLOTS;
+    while (count < slots) count <<= 1;
+    size_t size = sizeof(shm_ring) + count * sizeof(shm_slot);
+
+    shm_slot *scratch = (shm_slot*)malloc(sizeof(shm_slot));
+    if (!scratch) return -1;
+
+    void *mem;
+    if (path) {
+        /* 先删除旧文件：仍映射旧环的进程不受影响 */
+        unlink(path);
+        int fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) {
+            fprintf(stderr, "[logio] 无法创建共享环: %s (%s)\n", path, strerror(errno));
+            free(scratch);
+            return -1;
+        }
+        if (ftruncate(fd, (off_t)size) != 0) {
+            fprintf(stderr, "[logio] 无法设置共享环大小: %s (%s)\n", path, strerror(errno));
+            close(fd);
+            unlink(path);
+            free(scratch);
+            return -1;
+        }
+        mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+    } else {
+        mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    }
+    if (mem == MAP_FAILED) {
+        fprintf(stderr, "[logio] 共享环映射失败 (%s)\n", strerror(errno));
+        if (path) unlink(path);
+        free(scratch);
+        return -1;
+    }
+
+    shm_ring *r = (shm_ring*)mem;
+    memset(r, 0, sizeof(*r));
+    r->slot_size = (uint32_t)sizeof(shm_slot);
+    r->slot_count = count;
+    r->collector_pid = g_ctx.pid;
+    for (size_t i = 0; i < count; i++)
+        r->slots[i].seq = i;
+
+    LOG_MUTEX_LOCK(&g_ctx.mutex);
+    g_ctx.shm = r;
+    g_ctx.shm_size = size;
+    g_ctx.shm_path = path ? strdup(path) : NULL;
+    g_ctx.shm_scratch = scratch;
+    g_ctx.shm_role = LOG_SHM_COLLECTOR;
+    log_update_admit_mask();
+    LOG_ATOMIC_STORE(&r->magic, SHM_MAGIC);   // 头部就绪后才对附着方可见
+    LOG_COND_SIGNAL(&g_ctx.cond);             // 让写线程转入轮询
+    LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+    return 0;
+}
+
+int LogShmAttach(const char *path) {
+    if (path == NULL) {
+        /* fork 出的子进程：沿用继承的匿名映射，改为只写共享环 */
+        if (g_ctx.shm_role == LOG_SHM_PRODUCER) return 0;   // atfork 已切换并刷新了 pid
+        if (!g_ctx.shm || g_ctx.pid == (int)getpid()) return -1;
+        /* 父进程的锁可能在 fork 时被其他线程持有，子进程中重新初始化 */
+        LOG_MUTEX_INIT(&g_ctx.mutex);
+        LOG_COND_INIT(&g_ctx.cond);
+        g_ctx.pid = (int)getpid();
+        g_ctx.shm_role = LOG_SHM_PRODUCER;
+        g_ctx.thread_started = 0;   // 子进程中不存在写线程
+        return 0;
+    }
+    if (g_ctx.initialized) return -1;
+
+    int fd = open(path, O_RDWR);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(shm_ring)) {
+        close(fd);
+        return -1;
+    }
+    void *mem = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) return -1;
+    shm_ring *r = (shm_ring*)mem;
+    uint64_t count = r->slot_count;
+    if (LOG_ATOMIC_LOAD(&r->magic) != SHM_MAGIC || r->slot_size != sizeof(shm_slot) ||
+        count == 0 || (count & (count - 1)) != 0 ||
+        count > ((size_t)st.st_size - sizeof(shm_ring)) / sizeof(shm_slot)) {
+        munmap(mem, (size_t)st.st_size);
+        return -1;
+    }
+
+    LOG_MUTEX_INIT(&g_ctx.mutex);
+    LOG_COND_INIT(&g_ctx.cond);
+    g_ctx.pid = (int)getpid();
+    g_ctx.shm = r;
+    g_ctx.shm_size = (size_t)st.st_size;
+    g_ctx.shm_role = LOG_SHM_PRODUCER;
+    g_ctx.initialized = 1;
+    /* 由本进程 fork 出的工作进程需刷新进程 / 线程 ID，否则槽的占用者记为本进程 */
+    log_register_atfork();
+    return 0;
+}
+
+#else
+
+int LogShmCreate(const char *path, size_t slots) { (void)path; (void)slots; return -1; }
+int LogShmAttach(const char *path) { (void)path; return -1; }
+
+#endif /* !_WIN32 */
+
 void LogSetRolling(LogRollMode mode, long max_size_mb, int time_interval_sec) {
     if (!g_ctx.initialized) return;
     LOG_MUTEX_LOCK(&g_ctx.mutex);
@@ -750,14 +2382,161 @@ void LogSetRolling(LogRollMode mode, long max_size_mb, int time_interval_sec) {
     LOG_MUTEX_UNLOCK(&g_ctx.mutex);
 }
 
+void LogSetDedup(LogDedupMode mode, int window_ms) {
+    if (!g_ctx.initialized) return;
+    LOG_MUTEX_LOCK(&g_ctx.mutex);
+    log_dedup_flush_locked();
+    g_ctx.dedup_mode = mode;
+    g_ctx.dedup_window_ms = window_ms > 0 ? window_ms : DEDUP_DEFAULT_MS;
+    g_ctx.dedup_hash = 0;
+    LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+}
+
+int LogTailEnable(size_t records) {
+    if (!g_ctx.initialized || g_ctx.shm_role == LOG_SHM_PRODUCER || records == 0) return -1;
+    uint64_t cap = 1;
+    while (cap < records) cap <<= 1;
+    LOG_MUTEX_LOCK(&g_ctx.mutex);
+    if (g_ctx.tail) {
+        /* 读者可能正在访问，已有的环不再重新分配 */
+        LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+        return 0;
+    }
+    tail_slot *tail = (tail_slot*)calloc((size_t)cap, sizeof(tail_slot));
+    if (tail) {
+        g_ctx.tail_cap = cap;
+        g_ctx.tail_head = 0;
+        LOG_ATOMIC_STORE(&g_ctx.tail, tail);
+    }
+    LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+    return tail ? 0 : -1;
+}
+
+int LogTailOpen(LogTailCursor *cur, size_t backlog) {
+    if (!cur || !LOG_ATOMIC_LOAD(&g_ctx.tail)) return -1;
+    uint64_t head = LOG_ATOMIC_LOAD(&g_ctx.tail_head);
+    if (backlog > g_ctx.tail_cap) backlog = (size_t)g_ctx.tail_cap;
+    cur->next = head > backlog ? head - backlog : 0;
+    cur->lost = 0;
+    return 0;
+}
+
+int LogTailRead(LogTailCursor *cur, char *buf, size_t cap, LogLevel *level) {
+    tail_slot *tail = LOG_ATOMIC_LOAD(&g_ctx.tail);
+    if (!cur || !buf || cap == 0 || !tail) return -1;
+    for (;;) {
+        uint64_t head = LOG_ATOMIC_LOAD(&g_ctx.tail_head);
+        uint64_t n = cur->next;
+        if (n >= head) return 0;                 // 没有新记录
+        if (head - n > g_ctx.tail_cap) {         // 落后超过一圈，跳到仍保留的最早记录
+            cur->lost += head - g_ctx.tail_cap - n;
+            n = head - g_ctx.tail_cap;
+            cur->next = n;
+        }
+        tail_slot *slot = &tail[n & (g_ctx.tail_cap - 1)];
+        uint64_t seq = LOG_ATOMIC_LOAD(&slot->seq);
+        if (seq == 2 * n + 2) {
+            size_t len = slot->len;
+            if (len > TAIL_SLOT_LEN) len = TAIL_SLOT_LEN;
+            if (len > cap - 1) len = cap - 1;
+            LogLevel lv = (LogLevel)slot->level;
+            memcpy(buf, slot->line, len);
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq) {
+                buf[len] = '\0';
+                if (level) *level = lv;
+                cur->next = n + 1;
+                return (int)len;
+            }
+        }
+        /* 读取期间被覆盖：计为丢失并继续 */
+        cur->lost++;
+        cur->next = n + 1;
+    }
+}
+
+int LogSetTimeIndex(int enable, long granularity_kb) {
+    if (!g_ctx.initialized || granularity_kb < 0 || g_ctx.roll_follower) return -1;
+    LOG_MUTEX_LOCK(&g_ctx.mutex);
+    log_index_close();
+    g_ctx.index_enabled = enable;
+    g_ctx.index_gran = granularity_kb * 1024L;
+    log_output *file_out = log_main_file_output();
+    if (enable && file_out && file_out->target.file && file_out->target.file != stderr)
+        log_index_open();
+    int ok = !enable || g_ctx.index_file != NULL;
+    LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+    return ok ? 0 : -1;
+}
+
+int LogInstallCrashHandler(void) {
+#if !defined(_WIN32)
+    if (!g_ctx.initialized) return -1;
+
+    /* 预先取得时区偏移，信号处理中不能调用 localtime_r */
+    time_t now = time(NULL);
+    struct tm tm_buf;
+    localtime_r(&now, &tm_buf);
+    g_ctx.crash_gmtoff = tm_buf.tm_gmtoff;
+
+    /* 为调用线程准备备用栈，栈溢出导致的 SIGSEGV 也能处理 */
+    static char *alt_stack = NULL;
+    if (!alt_stack) {
+        size_t size = 64 * 1024;
+        alt_stack = (char*)malloc(size);
+        if (alt_stack) {
+            stack_t ss;
+            ss.ss_sp = alt_stack;
+            ss.ss_size = size;
+            ss.ss_flags = 0;
+            sigaltstack(&ss, NULL);
+        }
+    }
+
+    static int installed = 0;
+    if (installed) return 0;   // 重复安装会把自身保存为"原处理方式"
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = log_crash_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_ONSTACK;
+    for (int i = 0; i < CRASH_SIGNAL_COUNT; i++) {
+        if (sigaction(k_crash_signals[i], &sa, &g_crash_old[i]) != 0)
+            return -1;
+    }
+    installed = 1;
+    return 0;
+#else
+    return -1;
+#endif
+}
+
+void LogSetForkMode(LogForkMode mode) {
+    if (!g_ctx.initialized) return;
+    LOG_MUTEX_LOCK(&g_ctx.mutex);
+    g_ctx.fork_mode = mode;
+    LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+}
+
 void LogFlush(void) {
     if (!g_ctx.initialized) return;
+    if (g_ctx.fork_resume)
+        log_resume_after_fork();
+    if (g_ctx.shm_role == LOG_SHM_PRODUCER) {
+        /* 生产者只需等待收集者取走已提交的记录 */
+        log_shm_wait_drained();
+        return;
+    }
     /* 简单唤醒后台线程，并等待队列空 */
     LOG_MUTEX_LOCK(&g_ctx.mutex);
-    while (g_ctx.queue_count > 0) {
-        LOG_COND_SIGNAL(&g_ctx.cond);
-        LOG_COND_WAIT(&g_ctx.cond, &g_ctx.mutex);  /* 等待消费者处理完毕 */
-    }
+    log_wait_idle();   /* 等待消费者处理完毕，包括已出队、正在写出的一条 */
+    LOG_MUTEX_UNLOCK(&g_ctx.mutex);
+    if (g_ctx.shm_role == LOG_SHM_COLLECTOR)
+        log_shm_wait_drained();
+    /* 写出尚未到期的重复汇总 */
+    LOG_MUTEX_LOCK(&g_ctx.mutex);
+    log_dedup_flush_locked();
     LOG_MUTEX_UNLOCK(&g_ctx.mutex);
     /* 额外刷新所有输出 */
     for (int i = 0; i < g_ctx.output_count; i++) {
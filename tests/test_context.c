@@ -0,0 +1,64 @@
+/*
+ * 诊断上下文：压入/弹出、字段数与总长度上限，%X 与 %J 的输出，
+ * 以及上下文只属于压入它的线程
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <pthread.h>
+#include <string.h>
+
+static void *other_thread(void *arg) {
+    (void)arg;
+    LogPrintf(LOG_LEVEL_INFO, "from other thread");
+    return NULL;
+}
+
+int main(void) {
+    const char *path = "logs/context.log";
+    remove(path);
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+
+    CHECK(LogContextPush("req", "42") == 0);
+    CHECK(LogContextPush("user", "bob") == 0);
+    LogPrintf(LOG_LEVEL_INFO, "two fields");
+    LogPrintfJSON(LOG_LEVEL_INFO, "json \"two\"");
+
+    pthread_t th;
+    CHECK(pthread_create(&th, NULL, other_thread, NULL) == 0);
+    pthread_join(th, NULL);
+
+    LogContextPop();
+    LogPrintf(LOG_LEVEL_INFO, "after pop");
+
+    /* 字段数上限：已有 1 个，再压 7 个到满 8 个，第 9 个失败 */
+    char key[8];
+    for (int i = 0; i < 7; i++) {
+        snprintf(key, sizeof(key), "k%d", i);
+        CHECK(LogContextPush(key, "v") == 0);
+    }
+    CHECK(LogContextPush("extra", "v") == -1);
+    LogPrintf(LOG_LEVEL_INFO, "eight fields");
+
+    /* 总长度上限：失败时不改变已有上下文 */
+    LogContextClear();
+    char big[300];
+    memset(big, 'x', sizeof(big) - 1);
+    big[sizeof(big) - 1] = '\0';
+    CHECK(LogContextPush("big", big) == -1);
+    CHECK(LogContextPush("k", big + 47) == 0);   // 1 + 252 + 2 = 255 字节，装得下
+    CHECK(LogContextPush("a", "b") == -1);       // 再加 4 字节超过 256
+    LogContextClear();
+    LogContextPop();                             // 空上下文上弹出无副作用
+    LogPrintf(LOG_LEVEL_INFO, "cleared");
+    LogFlush();
+
+    CHECK(count_lines(path, "] {req=42 user=bob} two fields") == 1);
+    CHECK(count_lines(path, "\"req\":\"42\",\"user\":\"bob\",\"msg\":\"json \\\"two\\\"\"") == 1);
+    CHECK(count_lines(path, "] from other thread") == 1);
+    CHECK(count_lines(path, "{req=42} after pop") == 1);
+    CHECK(count_lines(path, "{req=42 k0=v k1=v k2=v k3=v k4=v k5=v k6=v} eight fields") == 1);
+    CHECK(count_lines(path, "extra") == 0);
+    CHECK(count_lines(path, "] cleared") == 1);
+    return 0;
+}
@@ -0,0 +1,53 @@
+/*
+ * C++ 前端：各类参数的渲染，nullptr 与空 C 字符串输出 "(null)"；
+ * 以 -Wpedantic 编译，宏不依赖 ##__VA_ARGS__
+ */
+#include "logio.hpp"
+#include "test_util.h"
+
+#include <string>
+
+/* 直接使用 C 接口：payload 是一个 int */
+static size_t render_int(const void *payload, size_t len, char *buf, size_t cap) {
+    int v;
+    if (len != sizeof(v)) return 0;
+    std::memcpy(&v, payload, sizeof(v));
+    return static_cast<size_t>(std::snprintf(buf, cap, "reserved %d", v));
+}
+
+int main() {
+    const char *path = "logs/cpp_frontend.log";
+    remove(path);
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+
+    std::string name = "alice";
+    std::string_view view = "view";
+    const char *none = nullptr;
+    LOGIO_INFO("no arguments");
+    LOGIO_INFO("user {} {} {}", name, view, "literal");
+    LOGIO_INFO("null {} {}", nullptr, none);
+    LOGIO_WARN("hex {:x} {:X} neg {}", 255, 0xabcu, -42);
+    LOGIO_ERROR("ratio {:.2} flag {} char {} {{braces}}", 3.14159, true, 'z');
+    LOGIO_DEBUG("below threshold {}", 1);
+    logio::info(LOGIO_FMT("function form {}"), 7);
+    std::string long_text(3000, 'x');
+    LOGIO_INFO("long {} end", long_text);   // 超过旧实现 512 字节的栈缓冲
+    void *buf = LogReserveDeferred(LOG_LEVEL_INFO, __FILE__, __LINE__, render_int, sizeof(int));
+    CHECK(buf != nullptr);
+    int v = 42;
+    std::memcpy(buf, &v, sizeof(v));
+    LogCommitDeferred(buf);
+    CHECK(LogReserveDeferred(LOG_LEVEL_DEBUG, __FILE__, __LINE__, render_int, sizeof(int)) == nullptr);
+    LogFlush();
+
+    CHECK(count_lines(path, "no arguments") == 1);
+    CHECK(count_lines(path, "user alice view literal") == 1);
+    CHECK(count_lines(path, "null (null) (null)") == 1);
+    CHECK(count_lines(path, "hex ff ABC neg -42") == 1);
+    CHECK(count_lines(path, "ratio 3.14 flag true char z {braces}") == 1);
+    CHECK(count_lines(path, "below threshold") == 0);
+    CHECK(count_lines(path, "function form 7") == 1);
+    CHECK(count_lines(path, ("long " + long_text + " end").c_str()) == 1);
+    CHECK(count_lines(path, "reserved 42") == 1);
+    return 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * 崩溃处理：写线程仍在消费队列时收到致命信号，队列中的每条记录应恰好写出一次
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define RECORDS 3000
+
+int main(void) {
+    const char *path = "logs/crash_flush.log";
+    remove(path);
+
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        if (InitLog(path, LOG_LEVEL_INFO) != 0 || LogInstallCrashHandler() != 0) _exit(2);
+        for (int i = 0; i < RECORDS; i++)
+            LogPrintf(LOG_LEVEL_INFO, "crash record %04d", i);
+        raise(SIGSEGV);
+        _exit(3);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+
+    static int seen[RECORDS];
+    FILE *fp = fopen(path, "r");
+    CHECK(fp != NULL);
+    char *line = (char*)malloc(LINE_MAX_LEN);
+    CHECK(line != NULL);
+    long signal_lines = 0;
+    while (fgets(line, LINE_MAX_LEN, fp)) {
+        const char *rec = strstr(line, "crash record ");
+        if (rec) {
+            int i = atoi(rec + 13);
+            CHECK(i >= 0 && i < RECORDS);
+            seen[i]++;
+        } else {
+            CHECK(strstr(line, "进程收到致命信号 11") != NULL);   // 除信号行外没有其他内容
+            signal_lines++;
+        }
+    }
+    free(line);
+    fclose(fp);
+
+    for (int i = 0; i < RECORDS; i++)
+        CHECK(seen[i] == 1);
+    CHECK(signal_lines == 1);
+    return 0;
+}
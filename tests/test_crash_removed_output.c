@@ -0,0 +1,41 @@
+/*
+ * 崩溃处理：移除主文件输出后，其描述符可能被其他文件复用，崩溃时不能写入该文件
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+int main(void) {
+    const char *path = "logs/crash_removed_output.log";
+    const char *other = "logs/crash_removed_output.other";
+    remove(path);
+    remove(other);
+
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        if (InitLog(path, LOG_LEVEL_INFO) != 0 || LogInstallCrashHandler() != 0) _exit(2);
+        LogPrintf(LOG_LEVEL_INFO, "before remove");
+        LogFlush();
+        if (LogRemoveOutput(0) != 0) _exit(3);
+        int fd = open(other, O_WRONLY | O_CREAT | O_TRUNC, 0644);   // 通常复用主文件的描述符
+        if (fd < 0) _exit(4);
+        raise(SIGSEGV);
+        _exit(5);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    CHECK(WIFSIGNALED(status) && WTERMSIG(status) == SIGSEGV);
+
+    struct stat st;
+    CHECK(stat(other, &st) == 0);
+    CHECK(st.st_size == 0);
+    CHECK(count_lines(path, "before remove") == 1);
+    CHECK(count_lines(path, "致命信号") == 0);
+    return 0;
+}
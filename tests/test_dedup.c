@@ -0,0 +1,28 @@
+/*
+ * 重复消息合并：LogFlush 返回时最后一条记录与待写的汇总都已落盘
+ */
+#include "logio.h"
+#include "test_util.h"
+
+int main(void) {
+    const char *path = "logs/dedup.log";
+    remove(path);
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+    LogSetDedup(LOG_DEDUP_EXACT, 60000);
+
+    for (int i = 0; i < 1000; i++)
+        LogPrintf(LOG_LEVEL_WARN, "connection refused to %s", "db");
+    LogFlush();
+    CHECK(count_lines(path, "connection refused") == 1);
+    CHECK(count_lines(path, "重复 999 次") == 1);
+
+    LogSetDedup(LOG_DEDUP_FORMAT, 60000);
+    for (int i = 0; i < 10; i++)
+        LogPrintf(LOG_LEVEL_INFO, "request %d done", i);
+    LogPrintf(LOG_LEVEL_INFO, "last line");
+    LogFlush();
+    CHECK(count_lines(path, "request 0 done") == 1);
+    CHECK(count_lines(path, "同格式）重复 9 次") == 1);
+    CHECK(count_lines(path, "last line") == 1);
+    return 0;
+}
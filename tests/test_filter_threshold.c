@@ -0,0 +1,31 @@
+/*
+ * 输出过滤：InitLog 阈值只是各输出的默认值，单个输出可以放宽到更低级别
+ */
+#include "logio.h"
+#include "test_util.h"
+
+static int g_debug_seen;
+
+static void on_log(LogLevel level, const char *message, time_t ts, int is_json, void *userdata) {
+    (void)message; (void)ts; (void)is_json; (void)userdata;
+    if (level == LOG_LEVEL_DEBUG) g_debug_seen++;
+}
+
+int main(void) {
+    const char *path = "logs/filter_threshold.log";
+    remove(path);
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+
+    int id = LogAddCallback(on_log, NULL);
+    CHECK(id > 0);
+    CHECK(LogSetOutputFilter(id, LOG_LEVEL_MASK(LOG_LEVEL_DEBUG), NULL) == 0);
+
+    LogPrintf(LOG_LEVEL_DEBUG, "debug only for the callback");
+    LogPrintf(LOG_LEVEL_INFO, "info for the file");
+    LogFlush();
+
+    CHECK(g_debug_seen == 1);
+    CHECK(count_lines(path, "debug only") == 0);   // 主文件仍按 InitLog 阈值过滤
+    CHECK(count_lines(path, "info for the file") == 1);
+    return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * LOG_FORK_DISABLE：子进程添加输出后仍保持关闭（没有写线程，不能阻塞），
+ * 退出时也不能删除父进程共享环的后备文件
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+int main(void) {
+    const char *path = "logs/fork_disable.log";
+    const char *ring = "logs/fork_disable.ring";
+    remove(path);
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+    CHECK(LogShmCreate(ring, 64) == 0);
+    LogSetForkMode(LOG_FORK_DISABLE);
+
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        alarm(10);                  // 队列写满后阻塞时由 SIGALRM 结束
+        LogAddOutputStream(stdout, 0);
+        for (int i = 0; i < 5000; i++)
+            LogPrintf(LOG_LEVEL_INFO, "from child %d", i);
+        LogFlush();
+        exit(0);                    // 经 atexit 执行清理
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    CHECK(access(ring, F_OK) == 0);
+
+    LogPrintf(LOG_LEVEL_INFO, "parent after child");
+    LogFlush();
+    CHECK(count_lines(path, "from child") == 0);
+    CHECK(count_lines(path, "parent after child") == 1);
+    return 0;
+}
@@ -0,0 +1,36 @@
+/*
+ * 在输出回调中调用 fork：写线程此时持有锁，atfork 处理不能再次加锁而死锁
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+static int g_child_status = -1;
+
+static void on_log(LogLevel level, const char *message, time_t ts, int is_json, void *userdata) {
+    (void)level; (void)ts; (void)is_json; (void)userdata;
+    if (!strstr(message, "spawn")) return;
+    pid_t pid = fork();
+    if (pid == 0) _exit(7);
+    if (pid > 0) waitpid(pid, &g_child_status, 0);
+}
+
+int main(void) {
+    const char *path = "logs/fork_in_callback.log";
+    remove(path);
+    alarm(10);                      // 死锁时以 SIGALRM 失败
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+    CHECK(LogAddCallback(on_log, NULL) > 0);
+
+    LogPrintf(LOG_LEVEL_INFO, "spawn a child");
+    LogFlush();
+    CHECK(WIFEXITED(g_child_status) && WEXITSTATUS(g_child_status) == 7);
+
+    /* 锁在父进程中已正常释放，之后的记录照常写出 */
+    LogPrintf(LOG_LEVEL_INFO, "after fork");
+    LogFlush();
+    CHECK(count_lines(path, "after fork") == 1);
+    return 0;
+}
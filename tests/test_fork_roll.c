@@ -0,0 +1,71 @@
+/*
+ * 继承模式下父子进程共用按大小滚动的文件：滚动只由父进程执行，所有记录都应保留
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define LINES 20000
+
+/* 统计 logs/ 下所有 fork_roll.log* 文件中包含 needle 的行数 */
+static long count_all(const char *needle) {
+    DIR *dir = opendir("logs");
+    if (!dir) return -1;
+    long total = 0;
+    char path[512];
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (strncmp(de->d_name, "fork_roll.log", 13) != 0 || strstr(de->d_name, ".idx")) continue;
+        snprintf(path, sizeof(path), "logs/%s", de->d_name);
+        long n = count_lines(path, needle);
+        if (n > 0) total += n;
+    }
+    closedir(dir);
+    return total;
+}
+
+static void remove_all(void) {
+    DIR *dir = opendir("logs");
+    if (!dir) return;
+    char path[512];
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        if (strncmp(de->d_name, "fork_roll.log", 13) != 0) continue;
+        snprintf(path, sizeof(path), "logs/%s", de->d_name);
+        remove(path);
+    }
+    closedir(dir);
+}
+
+static void write_lines(const char *who) {
+    for (int i = 0; i < LINES; i++)
+        LogPrintf(LOG_LEVEL_INFO, "%s line %05d ................................................", who, i);
+    LogFlush();
+}
+
+int main(void) {
+    remove_all();
+    CHECK(InitLog("logs/fork_roll.log", LOG_LEVEL_INFO) == 0);
+    LogSetRolling(LOG_ROLL_SIZE, 1, 0);
+    LogPrintf(LOG_LEVEL_INFO, "before fork");
+
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        CHECK(LogSetTimeIndex(1, 0) == -1);   // 共享文件的索引只属于父进程
+        write_lines("child");
+        _exit(0);
+    }
+    write_lines("parent");
+    int status;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    LogFlush();
+
+    CHECK(count_all("parent line") == LINES);
+    CHECK(count_all("child line") == LINES);
+    return 0;
+}
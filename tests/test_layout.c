@@ -0,0 +1,80 @@
+/*
+ * 布局编译：%% 输出单个 %，未知说明符与结尾孤立的 % 按字面量保留；
+ * 多个输出共用同一布局时只渲染一次，与其他布局的输出交替写出仍各自正确
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <string.h>
+
+/* 读取 path 的第 n 行（从 0 开始，去掉换行），成功返回 0 */
+static int read_line(const char *path, int n, char *buf, size_t cap) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    int rc = -1;
+    for (int i = 0; fgets(buf, (int)cap, fp); i++) {
+        if (i == n) {
+            buf[strcspn(buf, "\n")] = '\0';
+            rc = 0;
+            break;
+        }
+    }
+    fclose(fp);
+    return rc;
+}
+
+int main(void) {
+    const char *path = "logs/layout.log";
+    const char *same_a = "logs/layout_same_a.log";
+    const char *same_b = "logs/layout_same_b.log";
+    remove(path);
+    remove(same_a);
+    remove(same_b);
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+
+    FILE *fa = fopen(same_a, "w");
+    FILE *fb = fopen(same_b, "w");
+    CHECK(fa && fb);
+    int a = LogAddOutputStream(fa, 0);
+    int b = LogAddOutputStream(fb, 0);
+    CHECK(a > 0 && b > 0);
+
+    /* 主文件与 a、b 使用不同布局，a 与 b 共用一个 */
+    CHECK(LogSetOutputLayout(0, "100%% %Q|%m|%", NULL) == 0);
+    CHECK(LogSetOutputLayout(a, "<%L> %m", NULL) == 0);
+    CHECK(LogSetOutputLayout(b, "<%L> %m", NULL) == 0);
+    CHECK(LogSetOutputLayout(999, "%m", NULL) == -1);
+
+    LogPrintf(LOG_LEVEL_INFO, "first");
+    LogPrintf(LOG_LEVEL_WARN, "second");
+    LogFlush();
+    fflush(fa);
+    fflush(fb);
+
+    char line[256];
+    CHECK(read_line(path, 0, line, sizeof(line)) == 0);
+    CHECK(strcmp(line, "100% %Q|first|%") == 0);
+    CHECK(read_line(path, 1, line, sizeof(line)) == 0);
+    CHECK(strcmp(line, "100% %Q|second|%") == 0);
+
+    CHECK(read_line(same_a, 0, line, sizeof(line)) == 0);
+    CHECK(strcmp(line, "<INFO> first") == 0);
+    CHECK(read_line(same_b, 0, line, sizeof(line)) == 0);
+    CHECK(strcmp(line, "<INFO> first") == 0);
+    CHECK(read_line(same_a, 1, line, sizeof(line)) == 0);
+    CHECK(strcmp(line, "<WARN> second") == 0);
+    CHECK(read_line(same_b, 1, line, sizeof(line)) == 0);
+    CHECK(strcmp(line, "<WARN> second") == 0);
+
+    /* NULL 恢复默认布局 */
+    CHECK(LogSetOutputLayout(0, NULL, NULL) == 0);
+    LogPrintf(LOG_LEVEL_INFO, "third");
+    LogFlush();
+    CHECK(count_lines(path, "[INFO/") == 1);
+
+    LogRemoveOutput(a);
+    LogRemoveOutput(b);
+    fclose(fa);
+    fclose(fb);
+    return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * 共享环：用 LogShmAttach(path) 附着的主进程 fork 出的工作进程应以自身的 pid / tid 记录，
+ * 工作进程在槽内崩溃时收集者要认出占用者已退出（主进程仍存活），环不能停滞
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static const char *k_ring = "logs/shm_attached_fork.ring";
+
+/* 重新执行本程序得到的主进程：附着共享环，再 fork 工作进程 */
+static int run_master(void) {
+    alarm(20);
+    if (LogShmAttach(k_ring) != 0) return 2;
+
+    pid_t bad = fork();
+    if (bad < 0) return 3;
+    if (bad == 0) {
+        signal(SIGSEGV, SIG_DFL);
+        LogPrintf(LOG_LEVEL_INFO, "%s", (const char*)16);   // 占用槽后、发布前崩溃
+        _exit(0);
+    }
+    int status;
+    waitpid(bad, &status, 0);
+    if (!WIFSIGNALED(status)) return 4;
+
+    pid_t good = fork();
+    if (good < 0) return 3;
+    if (good == 0) {
+        alarm(10);                  // 环停滞时 LogFlush 不会返回
+        for (int i = 0; i < 100; i++) {
+            LogPrintf(LOG_LEVEL_INFO, "after crash %d from %d", i, (int)getpid());
+            if (i == 49) LogFlush();
+        }
+        LogFlush();
+        _exit(0);
+    }
+    waitpid(good, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return 5;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) return run_master();
+
+    const char *path = "logs/shm_attached_fork.log";
+    remove(path);
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+    CHECK(LogSetOutputLayout(0, "pid=%P tid=%t %m", NULL) == 0);
+    CHECK(LogShmCreate(k_ring, 64) == 0);
+
+    pid_t master = fork();
+    CHECK(master >= 0);
+    if (master == 0) {
+        execl(argv[0], argv[0], "master", (char*)NULL);
+        _exit(127);
+    }
+    int status;
+    waitpid(master, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    LogFlush();
+
+    CHECK(count_lines(path, "after crash") == 100);
+    CHECK(count_lines(path, "生产者已退出") == 1);
+
+    /* 每条记录的 pid / tid 都是工作进程自己的（单线程进程中 tid 等于 pid） */
+    FILE *fp = fopen(path, "r");
+    CHECK(fp != NULL);
+    char *line = (char*)malloc(LINE_MAX_LEN);
+    CHECK(line != NULL);
+    while (fgets(line, LINE_MAX_LEN, fp)) {
+        const char *from = strstr(line, " from ");
+        if (!strstr(line, "after crash") || !from) continue;
+        int worker = atoi(from + 6);
+        char expect[64];
+        snprintf(expect, sizeof(expect), "pid=%d tid=%d ", worker, worker);
+        CHECK(strncmp(line, expect, strlen(expect)) == 0);
+    }
+    free(line);
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,48 @@
+/*
+ * 共享环：生产者在占用槽之后、发布之前崩溃，收集者应跳过该槽并继续收集后续记录
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+int main(void) {
+    const char *path = "logs/shm_dead_producer.log";
+    remove(path);
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+    CHECK(LogShmCreate(NULL, 64) == 0);
+
+    pid_t bad = fork();
+    CHECK(bad >= 0);
+    if (bad == 0) {
+        signal(SIGSEGV, SIG_DFL);
+        /* 在槽内格式化时访问非法地址而崩溃 */
+        LogPrintf(LOG_LEVEL_INFO, "%s", (const char*)16);
+        _exit(0);
+    }
+    int status;
+    waitpid(bad, &status, 0);
+    CHECK(WIFSIGNALED(status));
+
+    pid_t good = fork();
+    CHECK(good >= 0);
+    if (good == 0) {
+        /* 两批共 100 条，超过环容量，必须越过被遗弃的槽进入下一圈 */
+        for (int i = 0; i < 100; i++) {
+            LogPrintf(LOG_LEVEL_INFO, "after crash %d", i);
+            if (i == 49) LogFlush();
+        }
+        LogFlush();
+        _exit(0);
+    }
+    waitpid(good, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    LogFlush();
+
+    CHECK(count_lines(path, "after crash") == 100);
+    CHECK(count_lines(path, "丢弃") == 0);
+    CHECK(count_lines(path, "生产者已退出") == 1);
+    return 0;
+}
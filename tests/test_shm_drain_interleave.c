@@ -0,0 +1,45 @@
+/*
+ * 共享环：收集者本进程持续写日志（队列一直不空）时，仍要按时取出共享环，生产者不丢记录
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define CHILD_LINES 2000
+
+int main(void) {
+    const char *path = "logs/shm_drain_interleave.log";
+    remove(path);
+    alarm(30);                      // 共享环得不到处理时子进程无法结束，以 SIGALRM 失败
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+    CHECK(LogShmCreate(NULL, 64) == 0);
+
+    pid_t pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        alarm(20);
+        /* 每 16 条停 1ms，速度远低于收集者的写出能力 */
+        struct timespec pause = { 0, 1000000 };
+        for (int i = 0; i < CHILD_LINES; i++) {
+            LogPrintf(LOG_LEVEL_INFO, "from child %d", i);
+            if (i % 16 == 15) nanosleep(&pause, NULL);
+        }
+        LogFlush();
+        _exit(0);
+    }
+
+    /* 子进程运行期间本进程一直写日志，队列始终处于满载 */
+    int status;
+    long n = 0;
+    while (waitpid(pid, &status, WNOHANG) == 0)
+        LogPrintf(LOG_LEVEL_INFO, "from parent %ld", n++);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    LogFlush();
+
+    CHECK(count_lines(path, "from child") == CHILD_LINES);
+    CHECK(count_lines(path, "丢弃") == 0);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*
+ * 尾随环：游标的 backlog 起点、读者落后超过一圈时跳到最早保留的记录
+ * 并把跳过的条数计入 lost，没有新记录时返回 0
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <string.h>
+
+/* 读取下一条记录并检查其正文以 want 结尾 */
+static void expect_next(LogTailCursor *cur, const char *want, LogLevel want_level) {
+    char buf[600];
+    LogLevel level = LOG_LEVEL_DEBUG;
+    int len = LogTailRead(cur, buf, sizeof(buf), &level);
+    CHECK(len > 0 && (size_t)len == strlen(buf));
+    size_t wlen = strlen(want);
+    CHECK((size_t)len >= wlen && strcmp(buf + len - wlen, want) == 0);
+    CHECK(buf[0] == '[');                       // 默认布局，不含换行
+    CHECK(level == want_level);
+}
+
+int main(void) {
+    const char *path = "logs/tail.log";
+    remove(path);
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+
+    LogTailCursor cur, all, live;
+    CHECK(LogTailOpen(&cur, 0) == -1);          // 未开启
+    CHECK(LogTailEnable(5) == 0);               // 向上取整为 8 条
+    CHECK(LogTailEnable(64) == 0);              // 已开启时不重新分配
+
+    LogPrintf(LOG_LEVEL_INFO, "msg 0");
+    LogPrintf(LOG_LEVEL_WARN, "msg 1");
+    LogPrintf(LOG_LEVEL_ERROR, "msg 2");
+    LogFlush();
+
+    /* backlog 2：只读最近两条 */
+    CHECK(LogTailOpen(&cur, 2) == 0);
+    expect_next(&cur, "] msg 1", LOG_LEVEL_WARN);
+    expect_next(&cur, "] msg 2", LOG_LEVEL_ERROR);
+    char buf[600];
+    CHECK(LogTailRead(&cur, buf, sizeof(buf), NULL) == 0);
+    CHECK(cur.lost == 0);
+
+    /* backlog 超过已有记录数：从第一条开始 */
+    CHECK(LogTailOpen(&all, 100) == 0);
+    expect_next(&all, "] msg 0", LOG_LEVEL_INFO);
+
+    /* 截断：结果仍以 '\0' 结尾 */
+    CHECK(LogTailRead(&all, buf, 4, NULL) == 3);
+    CHECK(strcmp(buf, "[WA") == 0);
+
+    /* backlog 0：之后写入 20 条，超过环容量 8 */
+    CHECK(LogTailOpen(&live, 0) == 0);
+    CHECK(LogTailRead(&live, buf, sizeof(buf), NULL) == 0);
+    for (int i = 3; i < 23; i++)
+        LogPrintf(LOG_LEVEL_INFO, "msg %d", i);
+    LogFlush();
+
+    /* head = 23，环只保留 15..22：msg 3..14 共 12 条计入 lost */
+    char want[16];
+    for (int i = 15; i < 23; i++) {
+        snprintf(want, sizeof(want), "] msg %d", i);
+        expect_next(&live, want, LOG_LEVEL_INFO);
+    }
+    CHECK(live.lost == 12);
+    CHECK(LogTailRead(&live, buf, sizeof(buf), NULL) == 0);
+
+    /* 旧游标停在 msg 3，同样跳到 msg 15 */
+    expect_next(&cur, "] msg 15", LOG_LEVEL_INFO);
+    CHECK(cur.lost == 12);
+
+    /* 停在 msg 2 的游标：msg 2..14 共 13 条丢失 */
+    expect_next(&all, "] msg 15", LOG_LEVEL_INFO);
+    CHECK(all.lost == 13);
+    return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * 时间索引：索引文件的内容、滚动时随日志改名，以及 logio-slice 按行首时间戳精确裁剪边界
+ */
+#include "logio.h"
+#include "test_util.h"
+
+#include <dirent.h>
+#include <time.h>
+
+#define BATCH 50
+
+/* 等到新的一秒开始，返回该秒 */
+static time_t next_second(void) {
+    time_t t0 = time(NULL);
+    struct timespec pause = { 0, 5000000 };
+    while (time(NULL) == t0) nanosleep(&pause, NULL);
+    return time(NULL);
+}
+
+/* 运行 logio-slice，统计输出中包含 needle 的行数（NULL 统计全部） */
+static long slice_lines(const char *path, long long from, long long to, const char *needle) {
+    char cmd[512];
+    if (to >= 0)
+        snprintf(cmd, sizeof(cmd), "../logio-slice %s @%lld @%lld", path, from, to);
+    else
+        snprintf(cmd, sizeof(cmd), "../logio-slice %s @%lld", path, from);
+    FILE *fp = popen(cmd, "r");
+    if (!fp) return -1;
+    char *line = (char*)malloc(LINE_MAX_LEN);
+    long n = 0;
+    while (line && fgets(line, LINE_MAX_LEN, fp))
+        if (!needle || strstr(line, needle)) n++;
+    free(line);
+    return pclose(fp) == 0 ? n : -1;
+}
+
+static long read_index(const char *idx_path, LogIndexEntry *e, long cap) {
+    FILE *fp = fopen(idx_path, "rb");
+    if (!fp) return -1;
+    char header[LOG_INDEX_HEADER_LEN];
+    long n = -1;
+    if (fread(header, 1, sizeof(header), fp) == sizeof(header) &&
+        memcmp(header, LOG_INDEX_MAGIC, sizeof(LOG_INDEX_MAGIC) - 1) == 0)
+        n = (long)fread(e, sizeof(*e), (size_t)cap, fp);
+    fclose(fp);
+    return n;
+}
+
+/* 粗粒度索引（只有第一条记录的索引项）：边界完全依靠行首时间戳裁剪 */
+static void check_slice(void) {
+    const char *path = "logs/time_index.log";
+    remove(path);
+    remove("logs/time_index.log.idx");
+    CHECK(InitLog(path, LOG_LEVEL_INFO) == 0);
+    CHECK(LogSetTimeIndex(1, 1024) == 0);
+
+    time_t sec[3];
+    for (int b = 0; b < 3; b++) {
+        sec[b] = next_second();
+        for (int i = 0; i < BATCH; i++)
+            LogPrintf(LOG_LEVEL_INFO, "batch %d line %d", b, i);
+        LogFlush();
+    }
+    CHECK(time(NULL) == sec[2]);   // 每批都在同一秒内写完
+
+    LogIndexEntry e[8];
+    CHECK(read_index("logs/time_index.log.idx", e, 8) == 1);
+    CHECK(e[0].timestamp == (int64_t)sec[0] && e[0].offset == 0);
+
+    CHECK(slice_lines(path, sec[1], sec[1], NULL) == BATCH);
+    CHECK(slice_lines(path, sec[1], sec[1], "batch 1") == BATCH);
+    CHECK(slice_lines(path, sec[1], -1, NULL) == 2 * BATCH);
+    CHECK(slice_lines(path, sec[0], sec[1], "batch 2") == 0);
+    CHECK(slice_lines(path, sec[2] + 5, -1, NULL) == 0);    // 起点晚于文件中的所有记录
+    CHECK(slice_lines(path, sec[0] - 5, sec[0] - 1, NULL) == 0);
+}
+
+/* 每秒一个索引项；按大小滚动时 .idx 随日志一起改名，新文件重新建立索引 */
+static void check_writer_and_roll(void) {
+    DIR *dir = opendir("logs");
+    CHECK(dir != NULL);
+    struct dirent *de;
+    char path[128];
+    while ((de = readdir(dir)) != NULL) {
+        if (strncmp(de->d_name, "time_index_roll.log", 19) != 0) continue;
+        snprintf(path, sizeof(path), "logs/%.100s", de->d_name);
+        remove(path);
+    }
+    closedir(dir);
+
+    CHECK(InitLog("logs/time_index_roll.log", LOG_LEVEL_INFO) == 0);
+    CHECK(LogSetTimeIndex(1, 0) == 0);
+    LogSetRolling(LOG_ROLL_SIZE, 1, 0);
+    time_t first = next_second();
+    for (int i = 0; i < 20; i++)
+        LogPrintf(LOG_LEVEL_INFO, "second one %d", i);
+    next_second();
+    /* 约 1.2MB，触发一次滚动 */
+    for (int i = 0; i < 12000; i++)
+        LogPrintf(LOG_LEVEL_INFO, "second two %05d ..........................................................................", i);
+    LogFlush();
+
+    char rolled[128] = "";
+    dir = opendir("logs");
+    CHECK(dir != NULL);
+    while ((de = readdir(dir)) != NULL) {
+        size_t len = strlen(de->d_name);
+        if (strncmp(de->d_name, "time_index_roll.log.", 20) == 0 &&
+            (len < 4 || strcmp(de->d_name + len - 4, ".idx") != 0))
+            snprintf(rolled, sizeof(rolled), "logs/%.100s", de->d_name);
+    }
+    closedir(dir);
+    CHECK(rolled[0] != '\0');
+
+    char idx[160];
+    snprintf(idx, sizeof(idx), "%s.idx", rolled);
+    LogIndexEntry e[8];
+    long n = read_index(idx, e, 8);
+    CHECK(n >= 2);                                   // 每秒一项
+    CHECK(e[0].timestamp == (int64_t)first && e[0].offset == 0);
+    CHECK(e[1].timestamp == (int64_t)first + 1 && e[1].offset > 0);
+    CHECK(slice_lines(rolled, first, first, "second one") == 20);
+    CHECK(slice_lines(rolled, first, first, "second two") == 0);
+
+    CHECK(read_index("logs/time_index_roll.log.idx", e, 8) >= 1);   // 新文件的索引
+    CHECK(e[0].offset == 0);
+}
+
+int main(void) {
+    check_slice();
+    check_writer_and_roll();
+    return 0;
+}
@@ -0,0 +1,33 @@
+/*
+ * 回归测试公共工具：每个测试是独立程序，在 bin/tests 下运行，日志写入 logs/
+ */
+#ifndef LOGIO_TEST_UTIL_H
+#define LOGIO_TEST_UTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CHECK(cond) do {                                                     \
+        if (!(cond)) {                                                       \
+            fprintf(stderr, "%s:%d: 检查失败: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1);                                                         \
+        }                                                                    \
+    } while (0)
+
+#define LINE_MAX_LEN 8192
+
+/* 统计文件中包含 needle 的行数（needle 为 NULL 时统计全部行），文件不存在返回 -1 */
+static inline long count_lines(const char *path, const char *needle) {
+    FILE *fp = fopen(path, "r");
+    if (!fp) return -1;
+    char *line = (char*)malloc(LINE_MAX_LEN);
+    long n = 0;
+    while (line && fgets(line, LINE_MAX_LEN, fp))
+        if (!needle || strstr(line, needle)) n++;
+    free(line);
+    fclose(fp);
+    return n;
+}
+
+#endif /* LOGIO_TEST_UTIL_H */
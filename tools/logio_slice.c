@@ -0,0 +1,243 @@
+/*
+ * logio-slice：借助 LogSetTimeIndex 生成的 .idx 旁路文件，按时间范围截取日志
+ *
+ * 用法：logio-slice <日志文件> <起始时间> [结束时间]
+ *   时间格式："YYYY-mm-dd HH:MM:SS"、"YYYY-mm-ddTHH:MM:SS"（本地时间）或 "@<Unix 秒>"
+ *   省略结束时间表示截取到文件末尾。
+ *
+ * 日志与索引均以 mmap 映射，二分查找到范围边界附近的索引项，再解析边界附近各行
+ * 开头的时间戳（"YYYY-mm-dd HH:MM:SS"）精确裁剪，只输出该区间的字节。
+ * 布局中没有时间戳时无法裁剪，边界按索引项对齐。
+ */
+#ifndef _GNU_SOURCE
+  #define _GNU_SOURCE            /* strptime */
+#endif
+
+#include "logio.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/* 只读映射整个文件，空文件返回 size 为 0 且指针为 NULL */
+static int map_file(const char *path, const unsigned char **data, size_t *size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    *size = (size_t)st.st_size;
+    *data = NULL;
+    if (*size > 0) {
+        void *p = mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            return -1;
+        }
+        *data = (const unsigned char*)p;
+    }
+    close(fd);
+    return 0;
+}
+
+/* 解析时间参数，失败返回 -1 */
+static int parse_time(const char *arg, time_t *out) {
+    if (arg[0] == '@') {
+        char *end = NULL;
+        long long v = strtoll(arg + 1, &end, 10);
+        if (!end || *end != '\0') return -1;
+        *out = (time_t)v;
+        return 0;
+    }
+    const char *formats[] = { "%Y-%m-%d %H:%M:%S", "%Y-%m-%dT%H:%M:%S" };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        struct tm tm_buf;
+        memset(&tm_buf, 0, sizeof(tm_buf));
+        const char *end = strptime(arg, formats[i], &tm_buf);
+        if (end && *end == '\0') {
+            tm_buf.tm_isdst = -1;
+            *out = mktime(&tm_buf);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+#define STAMP_LEN    19          // "YYYY-mm-dd HH:MM:SS"
+#define STAMP_WINDOW 96          // 只在行首这么多字节内查找时间戳
+
+/* 在行首查找时间戳并转换为本地时间，找不到返回 -1（续行或布局中没有 %T） */
+static int line_time(const unsigned char *p, size_t len, time_t *out) {
+    static const char shape[] = "dddd-dd-dd dd:dd:dd";
+    static char cached[STAMP_LEN];
+    static time_t cached_t = (time_t)-1;
+    if (len > STAMP_WINDOW) len = STAMP_WINDOW;
+    for (size_t i = 0; i + STAMP_LEN <= len; i++) {
+        size_t k = 0;
+        for (; k < STAMP_LEN; k++) {
+            unsigned char c = p[i + k];
+            if (shape[k] == 'd' ? (c < '0' || c > '9') : c != (unsigned char)shape[k]) break;
+        }
+        if (k < STAMP_LEN) continue;
+        const unsigned char *d = p + i;
+        /* 相邻行多在同一秒内，命中缓存时不再调用 mktime */
+        if (cached_t == (time_t)-1 || memcmp(cached, d, STAMP_LEN) != 0) {
+            struct tm tm_buf;
+            memset(&tm_buf, 0, sizeof(tm_buf));
+            tm_buf.tm_year = (d[0]-'0')*1000 + (d[1]-'0')*100 + (d[2]-'0')*10 + (d[3]-'0') - 1900;
+            tm_buf.tm_mon  = (d[5]-'0')*10 + (d[6]-'0') - 1;
+            tm_buf.tm_mday = (d[8]-'0')*10 + (d[9]-'0');
+            tm_buf.tm_hour = (d[11]-'0')*10 + (d[12]-'0');
+            tm_buf.tm_min  = (d[14]-'0')*10 + (d[15]-'0');
+            tm_buf.tm_sec  = (d[17]-'0')*10 + (d[18]-'0');
+            tm_buf.tm_isdst = -1;
+            cached_t = mktime(&tm_buf);
+            memcpy(cached, d, STAMP_LEN);
+        }
+        *out = cached_t;
+        return 0;
+    }
+    return -1;
+}
+
+/* 下一行的起始位置 */
+static size_t next_line(const unsigned char *data, size_t pos, size_t end) {
+    const unsigned char *nl = (const unsigned char*)memchr(data + pos, '\n', end - pos);
+    return nl ? (size_t)(nl - data) + 1 : end;
+}
+
+/* 在 [pos, limit) 中找第一条时间戳 >= from 的行；各行都没有时间戳时返回 pos（无法裁剪），
+ * 都早于 from 时返回 limit */
+static size_t trim_head(const unsigned char *data, size_t pos, size_t limit, time_t from) {
+    int stamped = 0;
+    for (size_t p = pos; p < limit; p = next_line(data, p, limit)) {
+        time_t t;
+        if (line_time(data + p, limit - p, &t) != 0) continue;   // 续行属于前一条记录
+        stamped = 1;
+        if (t >= from) return p;
+    }
+    return stamped ? limit : pos;
+}
+
+/* 从 pos 开始找第一条时间戳晚于 to 的行，返回其起始位置；没有则返回 end */
+static size_t trim_tail(const unsigned char *data, size_t pos, size_t end, time_t to) {
+    for (size_t p = pos; p < end; p = next_line(data, p, end)) {
+        time_t t;
+        if (line_time(data + p, end - p, &t) == 0 && t > to) return p;
+    }
+    return end;
+}
+
+/* 最后一个 timestamp <= t 的索引项，不存在返回 -1 */
+static long find_last_le(const LogIndexEntry *e, long n, time_t t) {
+    long lo = 0, hi = n;               // 在 [lo, hi) 中找第一个 > t 的项
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (e[mid].timestamp <= (int64_t)t) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo - 1;
+}
+
+/* 第一个 timestamp > t 的索引项，不存在返回 n */
+static long find_first_gt(const LogIndexEntry *e, long n, time_t t) {
+    return find_last_le(e, n, t) + 1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "用法: %s <日志文件> <起始时间> [结束时间]\n"
+            "  时间格式: \"YYYY-mm-dd HH:MM:SS\"、\"YYYY-mm-ddTHH:MM:SS\" 或 \"@<Unix 秒>\"\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3 || argc > 4) {
+        usage(argv[0]);
+        return 2;
+    }
+    const char *log_path = argv[1];
+    time_t from, to = (time_t)INT64_MAX;
+    if (parse_time(argv[2], &from) != 0 || (argc == 4 && parse_time(argv[3], &to) != 0)) {
+        fprintf(stderr, "[logio-slice] 无法解析时间参数\n");
+        usage(argv[0]);
+        return 2;
+    }
+    if (to < from) {
+        fprintf(stderr, "[logio-slice] 结束时间早于起始时间\n");
+        return 2;
+    }
+
+    const unsigned char *log_data, *idx_data;
+    size_t log_size, idx_size;
+    if (map_file(log_path, &log_data, &log_size) != 0) {
+        fprintf(stderr, "[logio-slice] 无法打开日志文件: %s (%s)\n", log_path, strerror(errno));
+        return 1;
+    }
+
+    size_t plen = strlen(log_path) + 5;
+    char *idx_path = (char*)malloc(plen);
+    if (!idx_path) return 1;
+    snprintf(idx_path, plen, "%s.idx", log_path);
+    if (map_file(idx_path, &idx_data, &idx_size) != 0) {
+        fprintf(stderr, "[logio-slice] 无法打开索引文件: %s (%s)，请在写日志时调用 LogSetTimeIndex\n",
+                idx_path, strerror(errno));
+        free(idx_path);
+        return 1;
+    }
+    if (idx_size < LOG_INDEX_HEADER_LEN ||
+        memcmp(idx_data, LOG_INDEX_MAGIC, sizeof(LOG_INDEX_MAGIC) - 1) != 0) {
+        fprintf(stderr, "[logio-slice] 索引文件格式无效: %s\n", idx_path);
+        free(idx_path);
+        return 1;
+    }
+    free(idx_path);
+
+    const LogIndexEntry *entries = (const LogIndexEntry*)(idx_data + LOG_INDEX_HEADER_LEN);
+    long n = (long)((idx_size - LOG_INDEX_HEADER_LEN) / sizeof(LogIndexEntry));
+
+    /* 起点：最后一个不晚于 from 的索引项；终点：第一个晚于 to 的索引项 */
+    long first = find_last_le(entries, n, from);
+    long last = find_first_gt(entries, n, to);
+    size_t start = first >= 0 ? (size_t)entries[first].offset : 0;
+    size_t end = last < n ? (size_t)entries[last].offset : log_size;
+    if (start > log_size) start = log_size;
+    if (end > log_size) end = log_size;
+
+    /* 索引项只标出每秒（或每段）的起点：起点之后、下一索引项之前的记录可能仍早于 from，
+     * 最后一个不晚于 to 的索引项之后的记录可能晚于 to，按行首时间戳裁掉 */
+    size_t head_limit = first + 1 < n ? (size_t)entries[first + 1].offset : log_size;
+    if (head_limit > end) head_limit = end;
+    if (head_limit > start)
+        start = trim_head(log_data, start, head_limit, from);
+    size_t tail_from = last - 1 >= 0 ? (size_t)entries[last - 1].offset : start;
+    if (tail_from < start) tail_from = start;
+    if (tail_from < end)
+        end = trim_tail(log_data, tail_from, end, to);
+
+    const unsigned char *p = log_data + start;
+    size_t remaining = end > start ? end - start : 0;
+    while (remaining > 0) {
+        size_t chunk = remaining < (1u << 20) ? remaining : (1u << 20);
+        if (fwrite(p, 1, chunk, stdout) != chunk) {
+            fprintf(stderr, "[logio-slice] 写出失败 (%s)\n", strerror(errno));
+            return 1;
+        }
+        p += chunk;
+        remaining -= chunk;
+    }
+    fflush(stdout);
+
+    if (log_data) munmap((void*)log_data, log_size);
+    munmap((void*)idx_data, idx_size);
+    return 0;
+}